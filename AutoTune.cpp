@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "AutoTune.h"
+#include "ChecksumKernel.h"
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+using namespace std;
+
+const int TUNE_TILE_FRAMES[] = { 1024, 4096, 8192, 16384, 32768 };
+const int TUNE_BLOCK_FRAMES[] = { 0, 2048, 8192 };
+const int TUNE_BLOCK_MONS[] = { 0, 64, 128, 256 };
+// A setting only replaces the best so far when it is clearly faster, not within timing noise
+const double TUNE_MIN_GAIN = 1.03;
+
+/* ******************************************************
+ * Purpose: Identifies the host a profile was tuned on:
+ *   its name, CPU model, logical CPUs and physical cores.
+ *   Cores count each SMT sibling group once.
+ * ******************************************************
+*/
+HostFingerprint readHostFingerprint() {
+    HostFingerprint host = { "unknown", "unknown", (int)max(1u, thread::hardware_concurrency()), 0 };
+#ifdef _WIN32
+    char hostName[MAX_COMPUTERNAME_LENGTH + 1];
+    DWORD hostNameLength = sizeof(hostName);
+    if (GetComputerNameA(hostName, &hostNameLength)) {
+        host.host = string(hostName, hostNameLength);
+    }
+#else
+    char hostName[256] = {};
+    if (gethostname(hostName, sizeof(hostName) - 1) == 0 && hostName[0] != '\0') {
+        host.host = hostName;
+    }
+    ifstream cpuInfo("/proc/cpuinfo");
+    string cpuInfoLine = "";
+    string physicalId = "";
+    set<pair<string, string>> cores = set<pair<string, string>>();
+    while (getline(cpuInfo, cpuInfoLine)) {
+        size_t colonIndex = cpuInfoLine.find(":");
+        if (colonIndex == string::npos) {
+            continue;
+        }
+        string name = cpuInfoLine.substr(0, cpuInfoLine.find_last_not_of(" \t", colonIndex - 1) + 1);
+        string value = colonIndex + 2 <= cpuInfoLine.length() ? cpuInfoLine.substr(colonIndex + 2) : "";
+        if (name == "model name" && host.cpuModel == "unknown") {
+            host.cpuModel = value;
+        } else if (name == "physical id") {
+            physicalId = value;
+        } else if (name == "core id") {
+            cores.insert(pair<string, string>(physicalId, value));
+        }
+    }
+    host.cores = cores.size();
+#endif
+    if (host.cores < 1 || host.cores > host.cpus) {
+        host.cores = host.cpus;
+    }
+    return host;
+}
+
+/* ******************************************************
+ * Purpose: Profile file of a host, named after it so
+ *   hosts sharing a directory keep their own
+ * ******************************************************
+*/
+string defaultTuneProfilePath(const HostFingerprint &host) {
+    string name = "";
+    for (char hostChar : host.host) {
+        name += isalnum((unsigned char)hostChar) || hostChar == '-' ? hostChar : '_';
+    }
+    return "./autotune_" + name + ".profile";
+}
+
+/* ******************************************************
+ * Purpose: Reads a tuned configuration. A profile from
+ *   another CPU model or CPU count is not used.
+ * ******************************************************
+ * Parameters:
+ *   profilePath: profile file
+ *   host: the host running now
+ *   config: Outputs the tuned configuration
+ * ******************************************************
+*/
+bool readTuneProfile(string profilePath, const HostFingerprint &host, TuneConfig &config) {
+    ifstream profileFile(profilePath);
+    if (!profileFile.is_open()) {
+        return false;
+    }
+    map<string, string> fields = map<string, string>();
+    string profileLine = "";
+    while (getline(profileFile, profileLine)) {
+        size_t equalsIndex = profileLine.find("=");
+        if (equalsIndex != string::npos) {
+            fields[profileLine.substr(0, equalsIndex)] = profileLine.substr(equalsIndex + 1);
+        }
+    }
+    if (fields["version"] != TUNE_PROFILE_VERSION || fields["cpu"] != host.cpuModel || fields["cpus"] != to_string(host.cpus)) {
+        return false;
+    }
+    try {
+        if (!parseChecksumKernel(fields["kernel"], config.kernel) || !checksumKernelSupported(config.kernel)) {
+            return false;
+        }
+        config.threads = stoi(fields["threads"]);
+        config.tileFrames = stoi(fields["tileFrames"]);
+        config.blockFrames = stoi(fields["blockFrames"]);
+        config.blockMons = stoi(fields["blockMons"]);
+        config.pairsPerSecond = stod(fields["pairsPerSecond"]);
+    }
+    catch (const exception &) {
+        return false;
+    }
+    return config.threads >= 1 && config.tileFrames >= 1;
+}
+
+/* ******************************************************
+ * Purpose: Writes a tuned configuration with the host it
+ *   was measured on
+ * ******************************************************
+ * Parameters:
+ *   profilePath: profile file
+ *   host: the host the configuration was measured on
+ *   config: tuned configuration
+ * ******************************************************
+*/
+void writeTuneProfile(string profilePath, const HostFingerprint &host, const TuneConfig &config) {
+    string temporaryPath = profilePath + ".tmp";
+    {
+        ofstream profileFile(temporaryPath, ios::out | ios::trunc);
+        profileFile << "version=" << TUNE_PROFILE_VERSION << '\n';
+        profileFile << "host=" << host.host << '\n';
+        profileFile << "cpu=" << host.cpuModel << '\n';
+        profileFile << "cpus=" << host.cpus << '\n';
+        profileFile << "cores=" << host.cores << '\n';
+        profileFile << "kernel=" << checksumKernelName(config.kernel) << '\n';
+        profileFile << "threads=" << config.threads << '\n';
+        profileFile << "tileFrames=" << config.tileFrames << '\n';
+        profileFile << "blockFrames=" << config.blockFrames << '\n';
+        profileFile << "blockMons=" << config.blockMons << '\n';
+        profileFile << fixed << setprecision(0) << "pairsPerSecond=" << config.pairsPerSecond << '\n';
+    }
+    filesystem::rename(temporaryPath, profilePath);
+}
+
+/* ******************************************************
+ * Purpose: Measures a configuration and keeps it if it
+ *   beats the best so far by more than the noise margin
+ * ******************************************************
+*/
+void tryTuneConfig(TuneConfig config, function<double(const TuneConfig &)> &measure, TuneConfig &best) {
+    config.pairsPerSecond = measure(config);
+    cout << left << setw(8) << checksumKernelName(config.kernel) << right << setw(9) << config.threads << setw(12) << config.tileFrames
+        << setw(13) << config.blockFrames << setw(11) << config.blockMons << fixed << setprecision(0) << setw(16) << config.pairsPerSecond << endl;
+    if (config.pairsPerSecond > best.pairsPerSecond * TUNE_MIN_GAIN) {
+        best = config;
+    }
+}
+
+/* ******************************************************
+ * Purpose: Searches one setting at a time for the fastest
+ *   configuration: the kernel on one thread, starting
+ *   from the one detectChecksumKernel picks, then the
+ *   thread count, the tile size and the frame and mon
+ *   blocking, each starting from the best found so far.
+ *   Thread counts are powers of two plus the physical
+ *   core and logical CPU counts, so SMT is measured
+ *   rather than assumed to help.
+ * ******************************************************
+ * Parameters:
+ *   host: the host being tuned
+ *   maxTileFrames: largest tile the calibration can fill
+ *   measure: runs the calibration sweep with a
+ *     configuration, returns pairs per second
+ * ******************************************************
+*/
+TuneConfig autotuneSearch(const HostFingerprint &host, int maxTileFrames, function<double(const TuneConfig &)> measure) {
+    cout << left << setw(8) << "kernel" << right << setw(9) << "threads" << setw(12) << "tileFrames" << setw(13) << "blockFrames" << setw(11) << "blockMons" << setw(16) << "pairs/s" << endl;
+    TuneConfig start = { detectChecksumKernel(), 1, min(8192, maxTileFrames), 0, 0, 0 };
+    TuneConfig best = start;
+    tryTuneConfig(start, measure, best);
+    for (int kernel = KERNEL_SCALAR; kernel <= KERNEL_AVX512; kernel++) {
+        if (kernel != start.kernel && checksumKernelSupported((ChecksumKernel)kernel)) {
+            TuneConfig config = start;
+            config.kernel = (ChecksumKernel)kernel;
+            tryTuneConfig(config, measure, best);
+        }
+    }
+
+    set<int> threadCounts = { host.cores, host.cpus };
+    for (int threads = 2; threads < host.cpus; threads *= 2) {
+        threadCounts.insert(threads);
+    }
+    TuneConfig base = best;
+    for (int threads : threadCounts) {
+        if (threads != base.threads) {
+            TuneConfig config = base;
+            config.threads = threads;
+            tryTuneConfig(config, measure, best);
+        }
+    }
+
+    base = best;
+    for (int tileFrames : TUNE_TILE_FRAMES) {
+        if (tileFrames != base.tileFrames && tileFrames <= maxTileFrames) {
+            TuneConfig config = base;
+            config.tileFrames = tileFrames;
+            tryTuneConfig(config, measure, best);
+        }
+    }
+
+    base = best;
+    for (int blockFrames : TUNE_BLOCK_FRAMES) {
+        for (int blockMons : TUNE_BLOCK_MONS) {
+            if ((blockFrames != 0 || blockMons != 0) && blockFrames < base.tileFrames) {
+                TuneConfig config = base;
+                config.blockFrames = blockFrames;
+                config.blockMons = blockMons;
+                tryTuneConfig(config, measure, best);
+            }
+        }
+    }
+    return best;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include "ChecksumKernel.h"
+using namespace std;
+
+struct HostFingerprint {
+    string host;
+    string cpuModel;
+    int cpus;
+    int cores;
+};
+
+struct TuneConfig {
+    ChecksumKernel kernel;
+    int threads;
+    int tileFrames;
+    int blockFrames;
+    int blockMons;
+    double pairsPerSecond;
+};
+
+const string TUNE_PROFILE_VERSION = "1";
+
+HostFingerprint readHostFingerprint();
+string defaultTuneProfilePath(const HostFingerprint &host);
+bool readTuneProfile(string profilePath, const HostFingerprint &host, TuneConfig &config);
+void writeTuneProfile(string profilePath, const HostFingerprint &host, const TuneConfig &config);
+TuneConfig autotuneSearch(const HostFingerprint &host, int maxTileFrames, function<double(const TuneConfig &)> measure);
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ChecksumEngine.h"
+#include "MatchFilter.h"
+#include "MatchRecord.h"
+#include "OtidTable.h"
+#include "RunContext.h"
+#include "SweepTile.h"
+#include "ThreadPool.h"
+using namespace std;
+
+const string ENGINE_DATA_ORDER[24] = {
+    "GAEM", "GAME", "GEAM", "GEMA", "GMAE", "GMEA",
+    "AGEM", "AGME", "AEGM", "AEMG", "AMGE", "AMEG",
+    "EGAM", "EGMA", "EAGM", "EAMG", "EMGA", "EMAG",
+    "MGAE", "MGEA", "MAGE", "MAEG", "MEGA", "MEAG"
+};
+
+/* ******************************************************
+ * Purpose: Builds the word order of each data order, the
+ *   same table as dataOrder.csv. Word d of a mon is the
+ *   encrypted word at 1 + 3 * (position of substructure
+ *   "GAEM"[d / 3] in the data order) + d % 3.
+ * ******************************************************
+ * Parameters:
+ *   dataOrder: data order string for each PID % 24
+ * ******************************************************
+*/
+map<string, vector<int>> buildDataOrderOrder(const string dataOrder[]) {
+    map<string, vector<int>> dataOrderOrder = map<string, vector<int>>();
+    for (int orderIndex = 0; orderIndex < 24; orderIndex++) {
+        vector<int> wordOrder = vector<int>();
+        for (int dataIndex = 0; dataIndex < 12; dataIndex++) {
+            wordOrder.push_back(1 + 3 * (int)dataOrder[orderIndex].find("GAEM"[dataIndex / 3]) + dataIndex % 3);
+        }
+        dataOrderOrder[dataOrder[orderIndex]] = wordOrder;
+    }
+    return dataOrderOrder;
+}
+
+/* ******************************************************
+ * Purpose: Reads a little endian 32 bit word
+ * ******************************************************
+*/
+long long readWordLittleEndian(const uint8_t* bytes) {
+    return (long long)bytes[0] | ((long long)bytes[1] << 8) | ((long long)bytes[2] << 16) | ((long long)bytes[3] << 24);
+}
+
+/* ******************************************************
+ * Purpose: Builds an engine from tables in memory, the
+ *   same as a run over OTIDs.csv, enemyDataList.csv and
+ *   dataOrder.csv would. The tables are read once; the
+ *   caller's buffers aren't kept.
+ * ******************************************************
+ * Parameters:
+ *   tables: TIDs, SIDs and raw enemy mons
+ *   pid: PID used for both keys
+ *   frames: number of enemy frames searchable, at most
+ *     tables.advances
+ *   filter: filter string as for --filter, empty for none
+ *   threads: number of worker threads
+ * ******************************************************
+*/
+ChecksumEngine::ChecksumEngine(const ChecksumTables &tables, long long pid, int frames, string filter, int threads) : pool_(threads > 0 ? threads : 1) {
+    if (tables.tids == nullptr || tables.sids == nullptr || tables.advances == 0) {
+        throw invalid_argument("tids and sids are required");
+    }
+    if (tables.monBytes == nullptr || tables.monCount == 0 || tables.monStride < MON_DATA_BYTES) {
+        throw invalid_argument("monBytes needs at least " + to_string(MON_DATA_BYTES) + " bytes per mon");
+    }
+    if (frames < 1 || (size_t)frames > tables.advances) {
+        throw invalid_argument("frames must be within 1 and " + to_string(tables.advances));
+    }
+
+    OtidTable otidTable = OtidTable();
+    otidTable.tids.assign(tables.tids, tables.tids + tables.advances);
+    otidTable.sids.assign(tables.sids, tables.sids + tables.advances);
+
+    // Same decoding as dataFileToMap: words 8 to 19 xor the mon's PID and OTID
+    vector<string> enemyList = vector<string>();
+    map<string, vector<long long>> enemyDict = map<string, vector<long long>>();
+    for (size_t monIndex = 0; monIndex < tables.monCount; monIndex++) {
+        const uint8_t* monBytes = tables.monBytes + monIndex * tables.monStride;
+        string monName = tables.monNames != nullptr && tables.monNames[monIndex] != nullptr ? tables.monNames[monIndex] : "mon" + to_string(monIndex);
+        long long monPid = readWordLittleEndian(monBytes);
+        long long monOtid = readWordLittleEndian(monBytes + 4);
+        vector<long long> enemyDataVector = { monPid };
+        for (int wordIndex = 0; wordIndex < 12; wordIndex++) {
+            enemyDataVector.push_back(readWordLittleEndian(monBytes + (wordIndex + 8) * 4) ^ monPid ^ monOtid);
+        }
+        // Mons are looked up by name, so a repeated name must repeat the same mon
+        if (enemyDict.count(monName) && enemyDict[monName] != enemyDataVector) {
+            throw invalid_argument("mon name " + monName + " is used for different mons");
+        }
+        enemyDict[monName] = enemyDataVector;
+        enemyList.push_back(monName);
+    }
+
+    map<string, vector<int>> dataOrderOrder = buildDataOrderOrder(ENGINE_DATA_ORDER);
+    context_.reset(new RunContext(pid, frames, parseMatchFilter(filter), detectChecksumKernel(), ENGINE_DATA_ORDER, dataOrderOrder, move(enemyList), enemyDict, move(otidTable)));
+}
+
+/* ******************************************************
+ * Purpose: Finds every match of a TID and frame range and
+ *   hands them over in TID, frame, mon order, one batch
+ *   per tile. Calls on one engine run one at a time.
+ * ******************************************************
+ * Parameters:
+ *   tidStart: first TID, inclusive
+ *   tidEnd: last TID, inclusive
+ *   frameStart: first frame, inclusive
+ *   frameEnd: last frame, inclusive
+ *   deliver: gets each batch of records, returns false
+ *     to stop the search
+ * ******************************************************
+ * Returns: number of records delivered
+ * ******************************************************
+*/
+uint64_t ChecksumEngine::findMatches(int tidStart, int tidEnd, int frameStart, int frameEnd, function<bool(const MatchRecord* records, size_t count)> deliver) {
+    if (tidStart < 0 || tidEnd < tidStart || tidEnd >= (int)context_->otidTable.tids.size()) {
+        throw out_of_range("tids must be within 0 and " + to_string(context_->otidTable.tids.size() - 1));
+    }
+    if (frameStart < 0 || frameEnd < frameStart || frameEnd >= context_->frames) {
+        throw out_of_range("frames must be within 0 and " + to_string(context_->frames - 1));
+    }
+    lock_guard<mutex> lock(callMutex_);
+
+    vector<SweepTile> tiles = buildSweepTiles(tidStart, tidEnd, frameStart, frameEnd + 1, DEFAULT_TILE_FRAMES);
+    size_t waveTiles = pool_.size() * 4;
+    uint64_t delivered = 0;
+    for (size_t waveStart = 0; waveStart < tiles.size(); waveStart += waveTiles) {
+        size_t waveEnd = min(tiles.size(), waveStart + waveTiles);
+        vector<vector<MatchRecord>> waveRecords = vector<vector<MatchRecord>>(waveEnd - waveStart);
+        for (size_t tileIndex = waveStart; tileIndex < waveEnd; tileIndex++) {
+            SweepTile tile = tiles[tileIndex];
+            vector<MatchRecord> &tileRecords = waveRecords[tileIndex - waveStart];
+            const RunContext &context = *context_;
+            pool_.enqueue([&context, tile, &tileRecords]() {
+                findTileRecords(context, context.filter, tile, tileRecords);
+                });
+        }
+        pool_.wait();
+
+        for (const vector<MatchRecord> &tileRecords : waveRecords) {
+            if (tileRecords.empty()) {
+                continue;
+            }
+            delivered += tileRecords.size();
+            if (!deliver(tileRecords.data(), tileRecords.size())) {
+                return delivered;
+            }
+        }
+    }
+    return delivered;
+}
+
+/* ******************************************************
+ * Purpose: Finds every match of a TID and frame range
+ *   into a caller's buffer, in TID, frame, mon order
+ * ******************************************************
+ * Parameters:
+ *   tidStart: first TID, inclusive
+ *   tidEnd: last TID, inclusive
+ *   frameStart: first frame, inclusive
+ *   frameEnd: last frame, inclusive
+ *   buffer: Outputs up to capacity records
+ *   capacity: number of records buffer holds
+ * ******************************************************
+ * Returns: number of matches in the range, records past
+ *   capacity are counted but not stored
+ * ******************************************************
+*/
+uint64_t ChecksumEngine::findMatches(int tidStart, int tidEnd, int frameStart, int frameEnd, MatchRecord* buffer, size_t capacity) {
+    uint64_t stored = 0;
+    return findMatches(tidStart, tidEnd, frameStart, frameEnd, [buffer, capacity, &stored](const MatchRecord* records, size_t count) {
+        for (size_t recordIndex = 0; recordIndex < count && stored < capacity; recordIndex++) {
+            buffer[stored++] = records[recordIndex];
+        }
+        return true;
+        });
+}
+
+int ChecksumEngine::monCount() const {
+    return context_->monTable.monCount;
+}
+
+int ChecksumEngine::frames() const {
+    return context_->frames;
+}
+
+const vector<string> &ChecksumEngine::monNames() const {
+    return context_->enemyList;
+}
+
+const RunContext &ChecksumEngine::context() const {
+    return *context_;
+}
+
+/* ******************************************************
+ * Purpose: Finds the match records of one tile with a
+ *   filter
+ * ******************************************************
+ * Parameters:
+ *   context: shared tables
+ *   filter: only matches passing this are kept
+ *   tile: TID and frame range to calc
+ *   records: Outputs records in frame, mon order
+ * ******************************************************
+*/
+void findTileRecords(const RunContext &context, const MatchFilter &filter, SweepTile tile, vector<MatchRecord> &records) {
+    const OtidTable &otidTable = context.otidTable;
+    const EnemyKeyIndex &enemyKeyIndex = context.enemyKeyIndex;
+    long long playerKey = context.pid ^ (((long long)otidTable.sids[tile.tid] << 16) + otidTable.tids[tile.tid]);
+
+    vector<EngineMatch> engineMatches = vector<EngineMatch>();
+    if (filter.active) {
+        findFilteredMatches(context.engine, enemyKeyIndex, playerKey, tile.frameStart, tile.frameEnd, filter, engineMatches);
+    } else {
+        context.engine.findMatches(playerKey, context.localEnemyKeys(), tile.frameStart, tile.frameEnd, engineMatches);
+    }
+    for (const EngineMatch &engineMatch : engineMatches) {
+        const MonRecord &record = context.monTable.record(engineMatch.monIndex, engineMatch.pokeball);
+        records.push_back(makeMatchRecord(tile.tid, engineMatch.frame, record, playerKey ^ enemyKeyIndex.keys[engineMatch.frame]));
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "MatchFilter.h"
+#include "MatchRecord.h"
+#include "RunContext.h"
+#include "SweepTile.h"
+#include "ThreadPool.h"
+using namespace std;
+
+// Input tables, copied once when the engine is built, so the caller's
+// arrays may be freed afterwards. monBytes holds monCount raw mons,
+// monStride bytes apart, laid out like the hex in enemyDataList.csv
+// (at least the first 80 bytes). monNames may be null.
+struct ChecksumTables {
+    const uint16_t* tids;
+    const uint16_t* sids;
+    size_t advances;
+    const uint8_t* monBytes;
+    size_t monCount;
+    size_t monStride;
+    const char* const* monNames;
+};
+
+const size_t MON_DATA_BYTES = 80;
+
+class ChecksumEngine {
+public:
+ChecksumEngine(const ChecksumTables &tables, long long pid, int frames, string filter = "", int threads = 1);
+uint64_t findMatches(int tidStart, int tidEnd, int frameStart, int frameEnd, function<bool(const MatchRecord* records, size_t count)> deliver);
+uint64_t findMatches(int tidStart, int tidEnd, int frameStart, int frameEnd, MatchRecord* buffer, size_t capacity);
+int monCount() const;
+int frames() const;
+const vector<string> &monNames() const;
+const RunContext &context() const;
+
+private:
+unique_ptr<RunContext> context_;
+ThreadPool pool_;
+mutex callMutex_;
+};
+
+map<string, vector<int>> buildDataOrderOrder(const string dataOrder[]);
+void findTileRecords(const RunContext &context, const MatchFilter &filter, SweepTile tile, vector<MatchRecord> &records);
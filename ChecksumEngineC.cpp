@@ -0,0 +1,99 @@
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include "ChecksumEngine.h"
+#include "ChecksumEngineC.h"
+#include "MatchRecord.h"
+using namespace std;
+
+static_assert(sizeof(RSChecksumMatch) == sizeof(MatchRecord), "RSChecksumMatch must match MatchRecord");
+
+struct RSChecksumEngine {
+    ChecksumEngine engine;
+};
+
+// Error of the calling thread's last failed call
+thread_local string lastError = "";
+
+/* ******************************************************
+ * Purpose: Builds an engine from caller buffers, see
+ *   ChecksumEngine::ChecksumEngine. The buffers are read
+ *   during the call only.
+ * ******************************************************
+ * Returns: engine, or null with rsChecksumLastError set
+ * ******************************************************
+*/
+RSChecksumEngine* rsChecksumEngineCreate(const uint16_t* tids, const uint16_t* sids, size_t advances,
+    const uint8_t* monBytes, size_t monCount, size_t monStride, const char* const* monNames,
+    long long pid, int frames, const char* filter, int threads) {
+    try {
+        ChecksumTables tables = { tids, sids, advances, monBytes, monCount, monStride, monNames };
+        return new RSChecksumEngine{ ChecksumEngine(tables, pid, frames, filter != nullptr ? filter : "", threads) };
+    }
+    catch (const exception &error) {
+        lastError = error.what();
+        return nullptr;
+    }
+}
+
+void rsChecksumEngineDestroy(RSChecksumEngine* engine) {
+    delete engine;
+}
+
+int rsChecksumEngineMonCount(const RSChecksumEngine* engine) {
+    return engine->engine.monCount();
+}
+
+const char* rsChecksumEngineMonName(const RSChecksumEngine* engine, int monIndex) {
+    if (monIndex < 0 || monIndex >= engine->engine.monCount()) {
+        return nullptr;
+    }
+    return engine->engine.monNames()[monIndex].c_str();
+}
+
+/* ******************************************************
+ * Purpose: Finds the matches of inclusive TID and frame
+ *   ranges into a caller buffer, such as a numpy array
+ *   of a 28 byte structured dtype
+ * ******************************************************
+ * Returns: number of matches, which may exceed capacity,
+ *   or -1 with rsChecksumLastError set
+ * ******************************************************
+*/
+int64_t rsChecksumEngineFindMatches(RSChecksumEngine* engine, int tidStart, int tidEnd, int frameStart, int frameEnd,
+    RSChecksumMatch* buffer, size_t capacity) {
+    try {
+        return engine->engine.findMatches(tidStart, tidEnd, frameStart, frameEnd, (MatchRecord*)buffer, capacity);
+    }
+    catch (const exception &error) {
+        lastError = error.what();
+        return -1;
+    }
+}
+
+/* ******************************************************
+ * Purpose: Finds the matches of inclusive TID and frame
+ *   ranges and hands each batch to a callback in TID,
+ *   frame, mon order
+ * ******************************************************
+ * Returns: number of matches delivered, or -1 with
+ *   rsChecksumLastError set
+ * ******************************************************
+*/
+int64_t rsChecksumEngineFindMatchesCallback(RSChecksumEngine* engine, int tidStart, int tidEnd, int frameStart, int frameEnd,
+    RSChecksumDeliver deliver, void* userData) {
+    try {
+        return engine->engine.findMatches(tidStart, tidEnd, frameStart, frameEnd, [deliver, userData](const MatchRecord* records, size_t count) {
+            return deliver((const RSChecksumMatch*)records, count, userData) != 0;
+            });
+    }
+    catch (const exception &error) {
+        lastError = error.what();
+        return -1;
+    }
+}
+
+const char* rsChecksumLastError(void) {
+    return lastError.c_str();
+}
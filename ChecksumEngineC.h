@@ -0,0 +1,44 @@
+#ifndef CHECKSUM_ENGINE_C
+#define CHECKSUM_ENGINE_C
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Same 28 byte layout as MatchRecord and combinedMatches.bin records */
+typedef struct RSChecksumMatch {
+    uint32_t tid;
+    uint32_t frame;
+    uint16_t monIndex;
+    uint8_t pokeball;
+    uint8_t flags;
+    uint32_t keyXorData0;
+    uint32_t keyXorData3;
+    uint32_t keyXorData4;
+    uint32_t keyXorData10;
+} RSChecksumMatch;
+
+typedef struct RSChecksumEngine RSChecksumEngine;
+
+/* Gets each batch of matches, returns 0 to stop the search */
+typedef int (*RSChecksumDeliver)(const RSChecksumMatch* matches, size_t count, void* userData);
+
+RSChecksumEngine* rsChecksumEngineCreate(const uint16_t* tids, const uint16_t* sids, size_t advances,
+    const uint8_t* monBytes, size_t monCount, size_t monStride, const char* const* monNames,
+    long long pid, int frames, const char* filter, int threads);
+void rsChecksumEngineDestroy(RSChecksumEngine* engine);
+int rsChecksumEngineMonCount(const RSChecksumEngine* engine);
+const char* rsChecksumEngineMonName(const RSChecksumEngine* engine, int monIndex);
+int64_t rsChecksumEngineFindMatches(RSChecksumEngine* engine, int tidStart, int tidEnd, int frameStart, int frameEnd,
+    RSChecksumMatch* buffer, size_t capacity);
+int64_t rsChecksumEngineFindMatchesCallback(RSChecksumEngine* engine, int tidStart, int tidEnd, int frameStart, int frameEnd,
+    RSChecksumDeliver deliver, void* userData);
+const char* rsChecksumLastError(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,303 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ChecksumKernel.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHECKSUM_KERNEL_X86
+#include <immintrin.h>
+#endif
+using namespace std;
+
+/* ******************************************************
+ * Purpose: Turns a mon's checksum residue into its first
+ *   matching pokeball
+ * ******************************************************
+ * Parameters:
+ *   tables: engine checksum tables
+ *   residue: base checksum - half sum - ball 0 term
+ *   keyHi: high 16 bits of keysXored
+ * ******************************************************
+ * Returns: first matching pokeball, 0 if none match
+ * ******************************************************
+*/
+uint8_t resolvePokeball(const KernelTables &tables, uint16_t residue, int keyHi) {
+    if ((residue & BALL_RESIDUE_MASK) != 0) {
+        return 0;
+    }
+    return tables.firstBalls[((keyHi >> POKEBALL_SHIFT) & 15) * 32 + (residue >> POKEBALL_SHIFT)];
+}
+
+/* ******************************************************
+ * Purpose: Finds the first matching pokeball of every
+ *   mon for each frame, one mon at a time
+ * ******************************************************
+ * Parameters:
+ *   tables: engine checksum tables
+ *   playerKey: Player key
+ *   enemyKeys: enemy key for each frame
+ *   frameStart: first frame to calc
+ *   frameEnd: frame to stop before
+ *   matches: Outputs matches in frame, mon order
+ * ******************************************************
+*/
+void findMatchesScalar(const KernelTables &tables, long long playerKey, const long long enemyKeys[], int frameStart, int frameEnd, vector<EngineMatch> &matches) {
+    for (int frame = frameStart; frame < frameEnd; frame++) {
+        long long keysXored = playerKey ^ enemyKeys[frame];
+        int keyLo = keysXored % 65536;
+        int keyHi = keysXored / 65536;
+        const uint16_t* row0 = tables.halfSums + ((0 * 256) + (keyLo & 255)) * tables.stride;
+        const uint16_t* row1 = tables.halfSums + ((1 * 256) + (keyLo >> 8)) * tables.stride;
+        const uint16_t* row2 = tables.halfSums + ((2 * 256) + (keyHi & 255)) * tables.stride;
+        const uint16_t* row3 = tables.halfSums + ((3 * 256) + (keyHi >> 8)) * tables.stride;
+
+        for (int monIndex = 0; monIndex < tables.monCount; monIndex++) {
+            uint16_t halfSum = row0[monIndex] + row1[monIndex] + row2[monIndex] + row3[monIndex];
+            uint16_t residue = tables.baseChecksums[monIndex] - halfSum - ((keyHi ^ tables.baseHi[monIndex]) & ~POKEBALL_HI_MASK);
+            int pokeball = resolvePokeball(tables, residue, keyHi);
+            if (pokeball != 0) {
+                matches.push_back({ frame, tables.monBase + monIndex, pokeball });
+            }
+        }
+    }
+}
+
+#ifdef CHECKSUM_KERNEL_X86
+
+/* ******************************************************
+ * Purpose: Resolves the pokeball of lanes whose residue
+ *   can match, skipping the padding lanes past the last
+ *   mon
+ * ******************************************************
+ * Parameters:
+ *   tables: engine checksum tables
+ *   residues: checksum residue per lane
+ *   lanes: number of lanes
+ *   keyHi: high 16 bits of keysXored
+ *   frame: frame of the lanes
+ *   monStart: block mon index of lane 0
+ *   matches: Outputs matches in mon order
+ * ******************************************************
+*/
+void pushLaneMatches(const KernelTables &tables, const uint16_t residues[], int lanes, int keyHi, int frame, int monStart, vector<EngineMatch> &matches) {
+    for (int lane = 0; lane < lanes && monStart + lane < tables.monCount; lane++) {
+        int pokeball = resolvePokeball(tables, residues[lane], keyHi);
+        if (pokeball != 0) {
+            matches.push_back({ frame, tables.monBase + monStart + lane, pokeball });
+        }
+    }
+}
+
+/* ******************************************************
+ * Purpose: SSE2 kernel, 8 mons per pass
+ * ******************************************************
+*/
+__attribute__((target("sse2")))
+void findMatchesSse2(const KernelTables &tables, long long playerKey, const long long enemyKeys[], int frameStart, int frameEnd, vector<EngineMatch> &matches) {
+    const int LANES = 8;
+    uint16_t residues[LANES];
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i keptHiBits = _mm_set1_epi16((short)(uint16_t)~POKEBALL_HI_MASK);
+    const __m128i residueBits = _mm_set1_epi16((short)BALL_RESIDUE_MASK);
+    for (int frame = frameStart; frame < frameEnd; frame++) {
+        long long keysXored = playerKey ^ enemyKeys[frame];
+        int keyLo = keysXored % 65536;
+        int keyHi = keysXored / 65536;
+        const uint16_t* row0 = tables.halfSums + ((0 * 256) + (keyLo & 255)) * tables.stride;
+        const uint16_t* row1 = tables.halfSums + ((1 * 256) + (keyLo >> 8)) * tables.stride;
+        const uint16_t* row2 = tables.halfSums + ((2 * 256) + (keyHi & 255)) * tables.stride;
+        const uint16_t* row3 = tables.halfSums + ((3 * 256) + (keyHi >> 8)) * tables.stride;
+        const __m128i keyHiVector = _mm_set1_epi16((short)keyHi);
+
+        for (int monStart = 0; monStart < tables.monCount; monStart += LANES) {
+            __m128i halfSum = _mm_add_epi16(
+                _mm_add_epi16(_mm_loadu_si128((const __m128i*)(row0 + monStart)), _mm_loadu_si128((const __m128i*)(row1 + monStart))),
+                _mm_add_epi16(_mm_loadu_si128((const __m128i*)(row2 + monStart)), _mm_loadu_si128((const __m128i*)(row3 + monStart))));
+            __m128i ballTerm = _mm_and_si128(_mm_xor_si128(keyHiVector, _mm_loadu_si128((const __m128i*)(tables.baseHi + monStart))), keptHiBits);
+            __m128i residue = _mm_sub_epi16(_mm_sub_epi16(_mm_loadu_si128((const __m128i*)(tables.baseChecksums + monStart)), halfSum), ballTerm);
+            // Only lanes whose low 11 residue bits are 0 can match any ball
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(residue, residueBits), zero)) != 0) {
+                _mm_storeu_si128((__m128i*)residues, residue);
+                pushLaneMatches(tables, residues, LANES, keyHi, frame, monStart, matches);
+            }
+        }
+    }
+}
+
+/* ******************************************************
+ * Purpose: AVX2 kernel, 16 mons per pass
+ * ******************************************************
+*/
+__attribute__((target("avx2")))
+void findMatchesAvx2(const KernelTables &tables, long long playerKey, const long long enemyKeys[], int frameStart, int frameEnd, vector<EngineMatch> &matches) {
+    const int LANES = 16;
+    uint16_t residues[LANES];
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i keptHiBits = _mm256_set1_epi16((short)(uint16_t)~POKEBALL_HI_MASK);
+    const __m256i residueBits = _mm256_set1_epi16((short)BALL_RESIDUE_MASK);
+    for (int frame = frameStart; frame < frameEnd; frame++) {
+        long long keysXored = playerKey ^ enemyKeys[frame];
+        int keyLo = keysXored % 65536;
+        int keyHi = keysXored / 65536;
+        const uint16_t* row0 = tables.halfSums + ((0 * 256) + (keyLo & 255)) * tables.stride;
+        const uint16_t* row1 = tables.halfSums + ((1 * 256) + (keyLo >> 8)) * tables.stride;
+        const uint16_t* row2 = tables.halfSums + ((2 * 256) + (keyHi & 255)) * tables.stride;
+        const uint16_t* row3 = tables.halfSums + ((3 * 256) + (keyHi >> 8)) * tables.stride;
+        const __m256i keyHiVector = _mm256_set1_epi16((short)keyHi);
+
+        for (int monStart = 0; monStart < tables.monCount; monStart += LANES) {
+            __m256i halfSum = _mm256_add_epi16(
+                _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(row0 + monStart)), _mm256_loadu_si256((const __m256i*)(row1 + monStart))),
+                _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(row2 + monStart)), _mm256_loadu_si256((const __m256i*)(row3 + monStart))));
+            __m256i ballTerm = _mm256_and_si256(_mm256_xor_si256(keyHiVector, _mm256_loadu_si256((const __m256i*)(tables.baseHi + monStart))), keptHiBits);
+            __m256i residue = _mm256_sub_epi16(_mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)(tables.baseChecksums + monStart)), halfSum), ballTerm);
+            // Only lanes whose low 11 residue bits are 0 can match any ball
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(residue, residueBits), zero)) != 0) {
+                _mm256_storeu_si256((__m256i*)residues, residue);
+                pushLaneMatches(tables, residues, LANES, keyHi, frame, monStart, matches);
+            }
+        }
+    }
+}
+
+/* ******************************************************
+ * Purpose: AVX-512 kernel, 32 mons per pass
+ * ******************************************************
+*/
+__attribute__((target("avx512f,avx512bw")))
+void findMatchesAvx512(const KernelTables &tables, long long playerKey, const long long enemyKeys[], int frameStart, int frameEnd, vector<EngineMatch> &matches) {
+    const int LANES = 32;
+    uint16_t residues[LANES];
+    const __m512i keptHiBits = _mm512_set1_epi16((short)(uint16_t)~POKEBALL_HI_MASK);
+    const __m512i residueBits = _mm512_set1_epi16((short)BALL_RESIDUE_MASK);
+    for (int frame = frameStart; frame < frameEnd; frame++) {
+        long long keysXored = playerKey ^ enemyKeys[frame];
+        int keyLo = keysXored % 65536;
+        int keyHi = keysXored / 65536;
+        const uint16_t* row0 = tables.halfSums + ((0 * 256) + (keyLo & 255)) * tables.stride;
+        const uint16_t* row1 = tables.halfSums + ((1 * 256) + (keyLo >> 8)) * tables.stride;
+        const uint16_t* row2 = tables.halfSums + ((2 * 256) + (keyHi & 255)) * tables.stride;
+        const uint16_t* row3 = tables.halfSums + ((3 * 256) + (keyHi >> 8)) * tables.stride;
+        const __m512i keyHiVector = _mm512_set1_epi16((short)keyHi);
+
+        for (int monStart = 0; monStart < tables.monCount; monStart += LANES) {
+            __m512i halfSum = _mm512_add_epi16(
+                _mm512_add_epi16(_mm512_loadu_si512(row0 + monStart), _mm512_loadu_si512(row1 + monStart)),
+                _mm512_add_epi16(_mm512_loadu_si512(row2 + monStart), _mm512_loadu_si512(row3 + monStart)));
+            __m512i ballTerm = _mm512_and_si512(_mm512_xor_si512(keyHiVector, _mm512_loadu_si512(tables.baseHi + monStart)), keptHiBits);
+            __m512i residue = _mm512_sub_epi16(_mm512_sub_epi16(_mm512_loadu_si512(tables.baseChecksums + monStart), halfSum), ballTerm);
+            // Only lanes whose low 11 residue bits are 0 can match any ball
+            if (_mm512_test_epi16_mask(residue, residueBits) != (__mmask32)0xFFFFFFFF) {
+                _mm512_storeu_si512(residues, residue);
+                pushLaneMatches(tables, residues, LANES, keyHi, frame, monStart, matches);
+            }
+        }
+    }
+}
+
+#endif
+
+/* ******************************************************
+ * Purpose: Picks the widest kernel this CPU can run
+ * ******************************************************
+*/
+ChecksumKernel detectChecksumKernel() {
+    if (checksumKernelSupported(KERNEL_AVX512)) {
+        return KERNEL_AVX512;
+    }
+    if (checksumKernelSupported(KERNEL_AVX2)) {
+        return KERNEL_AVX2;
+    }
+    if (checksumKernelSupported(KERNEL_SSE2)) {
+        return KERNEL_SSE2;
+    }
+    return KERNEL_SCALAR;
+}
+
+/* ******************************************************
+ * Purpose: Checks whether this CPU can run a kernel
+ * ******************************************************
+ * Parameters:
+ *   kernel: kernel to check
+ * ******************************************************
+*/
+bool checksumKernelSupported(ChecksumKernel kernel) {
+#ifdef CHECKSUM_KERNEL_X86
+    __builtin_cpu_init();
+    switch (kernel) {
+    case KERNEL_AVX512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    case KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2");
+    case KERNEL_SSE2:
+        return __builtin_cpu_supports("sse2");
+    default:
+        return true;
+    }
+#else
+    return kernel == KERNEL_SCALAR;
+#endif
+}
+
+string checksumKernelName(ChecksumKernel kernel) {
+    switch (kernel) {
+    case KERNEL_AVX512:
+        return "avx512";
+    case KERNEL_AVX2:
+        return "avx2";
+    case KERNEL_SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+/* ******************************************************
+ * Purpose: Converts a kernel name to a kernel
+ * ******************************************************
+ * Parameters:
+ *   name: scalar, sse2, avx2 or avx512
+ *   kernel: Outputs the named kernel
+ * ******************************************************
+*/
+bool parseChecksumKernel(string name, ChecksumKernel &kernel) {
+    ChecksumKernel kernels[4] = { KERNEL_SCALAR, KERNEL_SSE2, KERNEL_AVX2, KERNEL_AVX512 };
+    for (ChecksumKernel candidate : kernels) {
+        if (checksumKernelName(candidate) == name) {
+            kernel = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ******************************************************
+ * Purpose: Runs a frame range through the given kernel
+ * ******************************************************
+ * Parameters:
+ *   kernel: kernel to run, must be supported
+ *   tables: engine checksum tables
+ *   playerKey: Player key
+ *   enemyKeys: enemy key for each frame
+ *   frameStart: first frame to calc
+ *   frameEnd: frame to stop before
+ *   matches: Outputs matches in frame, mon order
+ * ******************************************************
+*/
+void findMatchesKernel(ChecksumKernel kernel, const KernelTables &tables, long long playerKey, const long long enemyKeys[], int frameStart, int frameEnd, vector<EngineMatch> &matches) {
+#ifdef CHECKSUM_KERNEL_X86
+    switch (kernel) {
+    case KERNEL_AVX512:
+        findMatchesAvx512(tables, playerKey, enemyKeys, frameStart, frameEnd, matches);
+        return;
+    case KERNEL_AVX2:
+        findMatchesAvx2(tables, playerKey, enemyKeys, frameStart, frameEnd, matches);
+        return;
+    case KERNEL_SSE2:
+        findMatchesSse2(tables, playerKey, enemyKeys, frameStart, frameEnd, matches);
+        return;
+    default:
+        break;
+    }
+#endif
+    findMatchesScalar(tables, playerKey, enemyKeys, frameStart, frameEnd, matches);
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+struct EngineMatch {
+    int frame;
+    int monIndex;
+    int pokeball;
+};
+
+enum ChecksumKernel {
+    KERNEL_SCALAR,
+    KERNEL_SSE2,
+    KERNEL_AVX2,
+    KERNEL_AVX512
+};
+
+struct KernelTables {
+    const uint16_t* halfSums;
+    const uint16_t* baseHi;
+    const uint16_t* baseChecksums;
+    const uint8_t* firstBalls;
+    int monBase;
+    int monCount;
+    int stride;
+};
+
+const int KERNEL_LANE_PADDING = 32;
+// Pokeball bits 27-30 of data[9] are bits 11-14 of its high half
+const int POKEBALL_SHIFT = 11;
+const uint16_t POKEBALL_HI_MASK = 0x7800;
+const uint16_t BALL_RESIDUE_MASK = 0x07FF;
+
+ChecksumKernel detectChecksumKernel();
+bool checksumKernelSupported(ChecksumKernel kernel);
+string checksumKernelName(ChecksumKernel kernel);
+bool parseChecksumKernel(string name, ChecksumKernel &kernel);
+uint8_t resolvePokeball(const KernelTables &tables, uint16_t residue, int keyHi);
+void findMatchesKernel(ChecksumKernel kernel, const KernelTables &tables, long long playerKey, const long long enemyKeys[], int frameStart, int frameEnd, vector<EngineMatch> &matches);
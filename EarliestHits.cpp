@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "EarliestHits.h"
+#include "MatchRecord.h"
+using namespace std;
+
+/* ******************************************************
+ * Purpose: Sets up an empty answer for each TID
+ * ******************************************************
+ * Parameters:
+ *   tidStart: first TID of the range
+ *   tidCount: number of TIDs in the range
+ *   hitsPerTid: matches to keep per TID, or per TID and
+ *     mon when perMon is set
+ *   perMon: keep the earliest matches of every mon
+ *   monCount: mons checked per frame
+ * ******************************************************
+*/
+EarliestHits::EarliestHits(int tidStart, int tidCount, int hitsPerTid, bool perMon, int monCount)
+    : tidStart_(tidStart), hitsPerTid_(hitsPerTid), perMon_(perMon), monCount_(monCount), bounds_(new atomic<int>[tidCount]), hits_(tidCount) {
+    for (int tidIndex = 0; tidIndex < tidCount; tidIndex++) {
+        bounds_[tidIndex].store(INT_MAX, memory_order_relaxed);
+    }
+}
+
+/* ******************************************************
+ * Purpose: Frame the TID's answer is complete before.
+ *   A tile starting at or after it can be skipped and a
+ *   tile crossing it can stop there.
+ * ******************************************************
+*/
+int EarliestHits::bound(int tid) const {
+    return bounds_[tid - tidStart_].load(memory_order_relaxed);
+}
+
+/* ******************************************************
+ * Purpose: Orders matches by frame, then mon, then
+ *   pokeball, the order the answer is kept in
+ * ******************************************************
+*/
+bool earlierMatch(const MatchRecord &record, const MatchRecord &other) {
+    if (record.frame != other.frame) {
+        return record.frame < other.frame;
+    }
+    if (record.monIndex != other.monIndex) {
+        return record.monIndex < other.monIndex;
+    }
+    return record.pokeball < other.pokeball;
+}
+
+/* ******************************************************
+ * Purpose: Merges a tile's matches into the TID's answer,
+ *   keeps only the earliest and lowers the TID's bound
+ *   once the answer is full
+ * ******************************************************
+ * Parameters:
+ *   tid: TID of the tile
+ *   records: matches of the tile, reordered
+ * ******************************************************
+*/
+void EarliestHits::add(int tid, vector<MatchRecord> &records) {
+    if (records.empty()) {
+        return;
+    }
+    sort(records.begin(), records.end(), earlierMatch);
+    int tidIndex = tid - tidStart_;
+    lock_guard<mutex> lock(stripes_[tidIndex % EARLIEST_LOCK_STRIPES]);
+    vector<MatchRecord> &hits = hits_[tidIndex];
+    vector<MatchRecord> merged = vector<MatchRecord>(hits.size() + records.size());
+    merge(hits.begin(), hits.end(), records.begin(), records.end(), merged.begin(), earlierMatch);
+
+    size_t wanted = perMon_ ? (size_t)hitsPerTid_ * monCount_ : (size_t)hitsPerTid_;
+    if (perMon_) {
+        vector<int> monHits = vector<int>(monCount_);
+        hits.clear();
+        for (const MatchRecord &record : merged) {
+            if (monHits[record.monIndex]++ < hitsPerTid_) {
+                hits.push_back(record);
+            }
+        }
+    } else {
+        merged.resize(min(merged.size(), wanted));
+        hits.swap(merged);
+    }
+
+    // Later frames can't displace a full answer, a match on its last frame still can
+    if (hits.size() == wanted) {
+        bounds_[tidIndex].store(hits.back().frame + 1, memory_order_relaxed);
+    }
+}
+
+/* ******************************************************
+ * Purpose: Earliest matches of a TID in frame, mon and
+ *   pokeball order. Call once the workers are done.
+ * ******************************************************
+*/
+const vector<MatchRecord> &EarliestHits::hits(int tid) const {
+    return hits_[tid - tidStart_];
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <atomic>
+#include <climits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "MatchRecord.h"
+using namespace std;
+
+const int EARLIEST_LOCK_STRIPES = 64;
+
+// The earliest hits of each TID in a range, shared by every worker.
+// Workers read a TID's frame bound without locking to skip tiles
+// that can no longer change its answer.
+class EarliestHits {
+public:
+EarliestHits(int tidStart, int tidCount, int hitsPerTid, bool perMon, int monCount);
+int bound(int tid) const;
+void add(int tid, vector<MatchRecord> &records);
+const vector<MatchRecord> &hits(int tid) const;
+
+private:
+int tidStart_;
+int hitsPerTid_;
+bool perMon_;
+int monCount_;
+unique_ptr<atomic<int>[]> bounds_;
+vector<vector<MatchRecord>> hits_;
+mutex stripes_[EARLIEST_LOCK_STRIPES];
+};
+
+bool earlierMatch(const MatchRecord &record, const MatchRecord &other);
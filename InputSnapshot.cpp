@@ -0,0 +1,345 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include "InputSnapshot.h"
+#include "MappedFile.h"
+#include "OtidTable.h"
+#include "RunManifest.h"
+using namespace std;
+
+const char INPUT_SNAPSHOT_MAGIC[4] = { 'R', 'S', 'S', 'N' };
+
+// magic, version, payload bytes, payload hash
+const size_t SNAPSHOT_HEADER_BYTES = 4 + 4 + 8 + 16;
+
+/* ******************************************************
+ * Purpose: Appends a value's bytes to the payload
+ * ******************************************************
+*/
+template< typename T >
+void appendValue(string &payload, T value) {
+    payload.append((const char*)&value, sizeof(value));
+}
+
+void appendString(string &payload, const string &value) {
+    appendValue<uint32_t>(payload, value.size());
+    payload += value;
+}
+
+/* ******************************************************
+ * Purpose: Reads a value from the mapped payload and
+ *   moves the cursor past it
+ * ******************************************************
+ * Parameters:
+ *   data: mapped file
+ *   size: mapped bytes
+ *   offset: cursor, moved past the value
+ *   value: Outputs the value
+ * ******************************************************
+*/
+template< typename T >
+bool readValue(const char* data, size_t size, size_t &offset, T &value) {
+    if (offset + sizeof(value) > size) {
+        return false;
+    }
+    memcpy(&value, data + offset, sizeof(value));
+    offset += sizeof(value);
+    return true;
+}
+
+bool readString(const char* data, size_t size, size_t &offset, string &value) {
+    uint32_t length = 0;
+    if (!readValue(data, size, offset, length) || offset + length > size) {
+        return false;
+    }
+    value.assign(data + offset, length);
+    offset += length;
+    return true;
+}
+
+/* ******************************************************
+ * Purpose: Records what an input file looked like when
+ *   the snapshot was built
+ * ******************************************************
+ * Parameters:
+ *   path: input file
+ * ******************************************************
+*/
+SnapshotInput describeSnapshotInput(string path) {
+    SnapshotInput input = { path, 0, 0, hashFile(path) };
+    error_code error;
+    input.size = filesystem::file_size(path, error);
+    filesystem::file_time_type modified = filesystem::last_write_time(path, error);
+    if (!error) {
+        input.modified = modified.time_since_epoch().count();
+    }
+    return input;
+}
+
+/* ******************************************************
+ * Purpose: Writes the parsed input tables as a snapshot:
+ *   a header with the payload hash, the size, time and
+ *   hash of every input file, the enemy mons, the data
+ *   orders and the OTIDs. Written to a .tmp file first so
+ *   a reader never sees half a snapshot.
+ * ******************************************************
+ * Parameters:
+ *   snapshotPath: snapshot file
+ *   inputs: input files the tables came from
+ *   enemyList: vector of enemy mons
+ *   enemyDict: map of enemy mon to enemy data
+ *   dataOrderOrder: map of data order to word order
+ *   otidTable: TID and SID per advance, may be empty
+ * ******************************************************
+*/
+bool writeInputSnapshot(string snapshotPath, const vector<SnapshotInput> &inputs, const vector<string> &enemyList, map<string, vector<long long>> &enemyDict, const map<string, vector<int>> &dataOrderOrder, const OtidTable &otidTable) {
+    string payload = "";
+    appendValue<uint32_t>(payload, inputs.size());
+    for (const SnapshotInput &input : inputs) {
+        appendString(payload, input.path);
+        appendValue<uint64_t>(payload, input.size);
+        appendValue<int64_t>(payload, input.modified);
+        appendString(payload, input.hash);
+    }
+
+    appendValue<uint32_t>(payload, enemyList.size());
+    for (const string &enemyMon : enemyList) {
+        appendString(payload, enemyMon);
+        const vector<long long> &enemyData = enemyDict[enemyMon];
+        for (int wordIndex = 0; wordIndex < 13; wordIndex++) {
+            appendValue<uint32_t>(payload, (uint32_t)enemyData[wordIndex]);
+        }
+    }
+    appendValue<uint32_t>(payload, dataOrderOrder.size());
+    for (const pair<const string, vector<int>> &order : dataOrderOrder) {
+        appendString(payload, order.first);
+        for (int wordIndex = 0; wordIndex < 12; wordIndex++) {
+            appendValue<int32_t>(payload, order.second[wordIndex]);
+        }
+    }
+
+    appendValue<uint32_t>(payload, otidTable.tids.size());
+    payload.append((const char*)otidTable.tids.data(), otidTable.tids.size() * sizeof(uint16_t));
+    payload.append((const char*)otidTable.sids.data(), otidTable.sids.size() * sizeof(uint16_t));
+
+    string header = string(INPUT_SNAPSHOT_MAGIC, 4);
+    appendValue<uint32_t>(header, INPUT_SNAPSHOT_VERSION);
+    appendValue<uint64_t>(header, payload.size());
+    header += hashBytes(payload);
+    {
+        ofstream snapshotFile(snapshotPath + ".tmp", ios::binary | ios::trunc);
+        snapshotFile.write(header.data(), header.size());
+        snapshotFile.write(payload.data(), payload.size());
+        if (!snapshotFile) {
+            return false;
+        }
+    }
+    error_code error;
+    filesystem::rename(snapshotPath + ".tmp", snapshotPath, error);
+    return !error;
+}
+
+InputSnapshot::InputSnapshot() : data_(nullptr), size_(0), tablesOffset_(0), otidsOffset_(0) {
+}
+
+/* ******************************************************
+ * Purpose: Maps a snapshot and checks its version and
+ *   payload hash. The input files are only checked when
+ *   asked about. Loading copies the tables out of the
+ *   mapping into the same maps and vectors parsing fills.
+ * ******************************************************
+ * Parameters:
+ *   snapshotPath: snapshot file
+ * ******************************************************
+ * Returns: false if the file is missing, from another
+ *   version or damaged
+ * ******************************************************
+*/
+bool InputSnapshot::open(string snapshotPath) {
+    file_.close();
+    data_ = nullptr;
+    size_ = 0;
+    inputs_.clear();
+    inputsUnchanged_.clear();
+    if (!file_.open(snapshotPath) || file_.size() < SNAPSHOT_HEADER_BYTES) {
+        file_.close();
+        return false;
+    }
+    data_ = file_.data();
+    size_ = file_.size();
+
+    size_t offset = 4;
+    uint32_t version = 0;
+    uint64_t payloadBytes = 0;
+    readValue(data_, size_, offset, version);
+    readValue(data_, size_, offset, payloadBytes);
+    if (memcmp(data_, INPUT_SNAPSHOT_MAGIC, 4) != 0 || version != INPUT_SNAPSHOT_VERSION || SNAPSHOT_HEADER_BYTES + payloadBytes != size_
+        || string(data_ + offset, 16) != hashBytes(data_ + SNAPSHOT_HEADER_BYTES, payloadBytes)) {
+        file_.close();
+        data_ = nullptr;
+        size_ = 0;
+        return false;
+    }
+
+    offset = SNAPSHOT_HEADER_BYTES;
+    uint32_t inputCount = 0;
+    readValue(data_, size_, offset, inputCount);
+    for (uint32_t inputIndex = 0; inputIndex < inputCount; inputIndex++) {
+        SnapshotInput input = SnapshotInput();
+        readString(data_, size_, offset, input.path);
+        readValue(data_, size_, offset, input.size);
+        readValue(data_, size_, offset, input.modified);
+        readString(data_, size_, offset, input.hash);
+        inputs_.push_back(input);
+    }
+
+    // Find where each section starts
+    tablesOffset_ = offset;
+    uint32_t monCount = 0;
+    readValue(data_, size_, offset, monCount);
+    for (uint32_t monIndex = 0; monIndex < monCount; monIndex++) {
+        uint32_t nameLength = 0;
+        readValue(data_, size_, offset, nameLength);
+        offset += nameLength + 13 * sizeof(uint32_t);
+    }
+    uint32_t orderCount = 0;
+    readValue(data_, size_, offset, orderCount);
+    for (uint32_t orderIndex = 0; orderIndex < orderCount; orderIndex++) {
+        uint32_t orderLength = 0;
+        readValue(data_, size_, offset, orderLength);
+        offset += orderLength + 12 * sizeof(int32_t);
+    }
+    otidsOffset_ = offset;
+    return offset <= size_;
+}
+
+/* ******************************************************
+ * Purpose: Checks an input file against the snapshot by
+ *   size and modification time, without reading it
+ * ******************************************************
+*/
+bool snapshotInputCurrent(const vector<SnapshotInput> &inputs, string path) {
+    for (const SnapshotInput &input : inputs) {
+        if (input.path != path) {
+            continue;
+        }
+        error_code error;
+        uint64_t size = filesystem::file_size(path, error);
+        filesystem::file_time_type modified = filesystem::last_write_time(path, error);
+        return !error && size == input.size && modified.time_since_epoch().count() == input.modified;
+    }
+    return false;
+}
+
+/* ******************************************************
+ * Purpose: Checks an input file still matches the
+ *   snapshot. The file is hashed the first time it is
+ *   asked about, so files a run never reads are never
+ *   hashed, and an edit that keeps its size and time is
+ *   still caught.
+ * ******************************************************
+*/
+bool InputSnapshot::inputCurrent(string path) const {
+    if (data_ == nullptr || !snapshotInputCurrent(inputs_, path)) {
+        return false;
+    }
+    if (!inputsUnchanged_.count(path)) {
+        for (const SnapshotInput &input : inputs_) {
+            if (input.path == path) {
+                inputsUnchanged_[path] = hashFile(path) == input.hash;
+            }
+        }
+    }
+    return inputsUnchanged_[path];
+}
+
+bool InputSnapshot::tablesCurrent(string enemyPath, string dataOrderPath) const {
+    return inputCurrent(enemyPath) && inputCurrent(dataOrderPath);
+}
+
+bool InputSnapshot::otidsCurrent(string otidPath) const {
+    return inputCurrent(otidPath);
+}
+
+/* ******************************************************
+ * Purpose: Fills the enemy and data order tables, the
+ *   same as dataFileToMap and dataOrderToMap would
+ * ******************************************************
+ * Parameters:
+ *   enemyList: Outputs vector of enemy mons
+ *   enemyDict: Outputs map of enemy mon to enemy data
+ *   dataOrderOrder: Outputs map of data order to word order
+ * ******************************************************
+*/
+void InputSnapshot::loadTables(vector<string> &enemyList, map<string, vector<long long>> &enemyDict, map<string, vector<int>> &dataOrderOrder) const {
+    size_t offset = tablesOffset_;
+    uint32_t monCount = 0;
+    readValue(data_, size_, offset, monCount);
+    for (uint32_t monIndex = 0; monIndex < monCount; monIndex++) {
+        string enemyMon = "";
+        readString(data_, size_, offset, enemyMon);
+        vector<long long> enemyData = vector<long long>(13);
+        for (int wordIndex = 0; wordIndex < 13; wordIndex++) {
+            uint32_t word = 0;
+            readValue(data_, size_, offset, word);
+            enemyData[wordIndex] = word;
+        }
+        enemyDict.insert(pair<string, vector<long long>>(enemyMon, enemyData));
+        enemyList.push_back(enemyMon);
+    }
+    uint32_t orderCount = 0;
+    readValue(data_, size_, offset, orderCount);
+    for (uint32_t orderIndex = 0; orderIndex < orderCount; orderIndex++) {
+        string order = "";
+        readString(data_, size_, offset, order);
+        vector<int> wordOrder = vector<int>(12);
+        for (int wordIndex = 0; wordIndex < 12; wordIndex++) {
+            int32_t word = 0;
+            readValue(data_, size_, offset, word);
+            wordOrder[wordIndex] = word;
+        }
+        dataOrderOrder.insert(pair<string, vector<int>>(order, wordOrder));
+    }
+}
+
+/* ******************************************************
+ * Purpose: Fills the OTID table from the mapped arrays
+ * ******************************************************
+ * Parameters:
+ *   otidTable: Outputs TID and SID per advance
+ * ******************************************************
+*/
+void InputSnapshot::loadOtids(OtidTable &otidTable) const {
+    size_t offset = otidsOffset_;
+    uint32_t otidCount = 0;
+    readValue(data_, size_, offset, otidCount);
+    if (offset + otidCount * 2 * sizeof(uint16_t) > size_) {
+        return;
+    }
+    const uint16_t* tids = (const uint16_t*)(data_ + offset);
+    const uint16_t* sids = tids + otidCount;
+    otidTable.tids.assign(tids, tids + otidCount);
+    otidTable.sids.assign(sids, sids + otidCount);
+}
+
+/* ******************************************************
+ * Purpose: Hash of an input file as of the snapshot,
+ *   empty if the file changed since or isn't recorded
+ * ******************************************************
+*/
+string InputSnapshot::inputHash(string path) const {
+    if (!inputCurrent(path)) {
+        return "";
+    }
+    for (const SnapshotInput &input : inputs_) {
+        if (input.path == path) {
+            return input.hash;
+        }
+    }
+    return "";
+}
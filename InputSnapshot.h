@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "OtidTable.h"
+using namespace std;
+
+struct SnapshotInput {
+    string path;
+    uint64_t size;
+    int64_t modified;
+    string hash;
+};
+
+const uint32_t INPUT_SNAPSHOT_VERSION = 1;
+
+class InputSnapshot {
+public:
+InputSnapshot();
+bool open(string snapshotPath);
+bool tablesCurrent(string enemyPath, string dataOrderPath) const;
+bool otidsCurrent(string otidPath) const;
+void loadTables(vector<string> &enemyList, map<string, vector<long long>> &enemyDict, map<string, vector<int>> &dataOrderOrder) const;
+void loadOtids(OtidTable &otidTable) const;
+string inputHash(string path) const;
+
+private:
+bool inputCurrent(string path) const;
+
+MappedFile file_;
+const char* data_;
+size_t size_;
+vector<SnapshotInput> inputs_;
+mutable map<string, bool> inputsUnchanged_;
+size_t tablesOffset_;
+size_t otidsOffset_;
+};
+
+SnapshotInput describeSnapshotInput(string path);
+bool writeInputSnapshot(string snapshotPath, const vector<SnapshotInput> &inputs, const vector<string> &enemyList, map<string, vector<long long>> &enemyDict, const map<string, vector<int>> &dataOrderOrder, const OtidTable &otidTable);
@@ -0,0 +1,122 @@
+#include <cstddef>
+#include <string>
+#include "MappedFile.h"
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+MappedFile::MappedFile() : data_(nullptr), size_(0) {
+#ifdef _WIN32
+    fileHandle_ = INVALID_HANDLE_VALUE;
+    mappingHandle_ = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+/* ******************************************************
+ * Purpose: Maps a file, with mmap or MapViewOfFile on
+ *   Windows. Pages are read in by the OS as they are
+ *   touched, and pages written through a writable
+ *   mapping are written back to the file by the OS.
+ * ******************************************************
+ * Parameters:
+ *   path: file to map
+ *   writable: map for writing, the file keeps its size
+ * ******************************************************
+ * Returns: false if the file is missing, empty or can't
+ *   be mapped
+ * ******************************************************
+*/
+bool MappedFile::open(string path, bool writable) {
+    close();
+#ifdef _WIN32
+    fileHandle_ = CreateFileA(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle_ == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle_, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return false;
+    }
+    mappingHandle_ = CreateFileMappingA(fileHandle_, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+    data_ = mappingHandle_ != nullptr ? (char*)MapViewOfFile(mappingHandle_, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (data_ == nullptr) {
+        close();
+        return false;
+    }
+    size_ = fileSize.QuadPart;
+#else
+    int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, fileStat.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    data_ = (char*)mapping;
+    size_ = fileStat.st_size;
+#endif
+    return true;
+}
+
+/* ******************************************************
+ * Purpose: Unmaps the file, pointers into it are no
+ *   longer valid
+ * ******************************************************
+*/
+void MappedFile::close() {
+#ifdef _WIN32
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+    }
+    if (mappingHandle_ != nullptr) {
+        CloseHandle(mappingHandle_);
+    }
+    if (fileHandle_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle_);
+    }
+    fileHandle_ = INVALID_HANDLE_VALUE;
+    mappingHandle_ = nullptr;
+#else
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+const char* MappedFile::data() const {
+    return data_;
+}
+
+/* ******************************************************
+ * Purpose: The mapping to write through, only for a file
+ *   opened writable
+ * ******************************************************
+*/
+char* MappedFile::writableData() const {
+    return data_;
+}
+
+size_t MappedFile::size() const {
+    return size_;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <string>
+using namespace std;
+
+// A whole file mapped into memory, read-only unless opened writable
+class MappedFile {
+public:
+MappedFile();
+~MappedFile();
+MappedFile(const MappedFile &) = delete;
+MappedFile &operator=(const MappedFile &) = delete;
+bool open(string path, bool writable = false);
+void close();
+const char* data() const;
+char* writableData() const;
+size_t size() const;
+
+private:
+char* data_;
+size_t size_;
+#ifdef _WIN32
+void* fileHandle_;
+void* mappingHandle_;
+#endif
+};
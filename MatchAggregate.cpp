@@ -0,0 +1,167 @@
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MatchAggregate.h"
+#include "MatchExport.h"
+#include "MatchRecord.h"
+using namespace std;
+
+const string HISTOGRAM_CSV_HEADER = "Dimension,Value,Matches,Aces\n";
+
+MatchAggregator::MatchAggregator(int monCount) : monCount_(monCount) {
+}
+
+/* ******************************************************
+ * Purpose: Returns the calling thread's histogram,
+ *   creating it the first time the thread asks. Only that
+ *   thread adds to it, so counting takes no lock.
+ * ******************************************************
+*/
+MatchHistogram &MatchAggregator::local() {
+    lock_guard<mutex> lock(mutex_);
+    unique_ptr<MatchHistogram> &histogram = histograms_[this_thread::get_id()];
+    if (!histogram) {
+        histogram.reset(new MatchHistogram());
+        histogram->mons.resize(monCount_);
+        histogram->species.resize(HISTOGRAM_VALUES);
+        histogram->heldItems.resize(HISTOGRAM_VALUES);
+    }
+    return *histogram;
+}
+
+/* ******************************************************
+ * Purpose: Sums every thread's histogram. Call once the
+ *   workers are done.
+ * ******************************************************
+*/
+MatchHistogram MatchAggregator::merged() const {
+    MatchHistogram histogram = MatchHistogram();
+    histogram.mons.resize(monCount_);
+    histogram.species.resize(HISTOGRAM_VALUES);
+    histogram.heldItems.resize(HISTOGRAM_VALUES);
+    lock_guard<mutex> lock(mutex_);
+    for (const pair<const thread::id, unique_ptr<MatchHistogram>> &threadHistogram : histograms_) {
+        mergeHistogram(histogram, *threadHistogram.second);
+    }
+    return histogram;
+}
+
+void addCount(HistogramCount &count, bool ace) {
+    count.matches++;
+    count.aces += ace ? 1 : 0;
+}
+
+void addCount(HistogramCount &count, const HistogramCount &other) {
+    count.matches += other.matches;
+    count.aces += other.aces;
+}
+
+/* ******************************************************
+ * Purpose: Counts a match by mon, species, held item,
+ *   pokeball and egg bit
+ * ******************************************************
+ * Parameters:
+ *   histogram: histogram to count in
+ *   record: match record
+ * ******************************************************
+*/
+void addMatchToHistogram(MatchHistogram &histogram, const MatchRecord &record) {
+    bool ace = (record.flags & MATCH_FLAG_ACE) != 0;
+    addCount(histogram.total, ace);
+    addCount(histogram.mons[record.monIndex], ace);
+    addCount(histogram.species[record.keyXorData0 & 0xFFFF], ace);
+    addCount(histogram.heldItems[record.keyXorData0 >> 16], ace);
+    addCount(histogram.pokeballs[record.pokeball], ace);
+    addCount(histogram.eggs[(record.keyXorData10 >> 30) & 1], ace);
+}
+
+/* ******************************************************
+ * Purpose: Adds another histogram of the same mons
+ * ******************************************************
+ * Parameters:
+ *   histogram: histogram to add to
+ *   other: histogram to add
+ * ******************************************************
+*/
+void mergeHistogram(MatchHistogram &histogram, const MatchHistogram &other) {
+    addCount(histogram.total, other.total);
+    for (size_t monIndex = 0; monIndex < other.mons.size() && monIndex < histogram.mons.size(); monIndex++) {
+        addCount(histogram.mons[monIndex], other.mons[monIndex]);
+    }
+    for (size_t value = 0; value < other.species.size() && value < histogram.species.size(); value++) {
+        addCount(histogram.species[value], other.species[value]);
+        addCount(histogram.heldItems[value], other.heldItems[value]);
+    }
+    for (int pokeball = 0; pokeball < 13; pokeball++) {
+        addCount(histogram.pokeballs[pokeball], other.pokeballs[pokeball]);
+    }
+    for (int egg = 0; egg < 2; egg++) {
+        addCount(histogram.eggs[egg], other.eggs[egg]);
+    }
+}
+
+void appendHistogramRow(string &out, const string &dimension, const string &value, const HistogramCount &count) {
+    out += dimension + "," + value + "," + to_string(count.matches) + "," + to_string(count.aces) + "\n";
+}
+
+/* ******************************************************
+ * Purpose: Writes the histogram as one csv table, a row
+ *   per dimension and value that had a match
+ * ******************************************************
+ * Parameters:
+ *   histogramPath: csv file to write
+ *   histogram: merged histogram
+ *   enemyList: vector of enemy mons, names the mon rows
+ *     and merges mons of the same name
+ * ******************************************************
+*/
+bool writeHistogramCsv(string histogramPath, const MatchHistogram &histogram, const vector<string> &enemyList) {
+    string out = HISTOGRAM_CSV_HEADER;
+    appendHistogramRow(out, "total", "all", histogram.total);
+    // Mons sharing a name, as rematches can, are one row, the same as query --mon
+    vector<string> monNames = vector<string>();
+    map<string, HistogramCount> monCounts = map<string, HistogramCount>();
+    for (size_t monIndex = 0; monIndex < histogram.mons.size(); monIndex++) {
+        if (histogram.mons[monIndex].matches > 0) {
+            if (!monCounts.count(enemyList[monIndex])) {
+                monNames.push_back(enemyList[monIndex]);
+            }
+            addCount(monCounts[enemyList[monIndex]], histogram.mons[monIndex]);
+        }
+    }
+    for (const string &monName : monNames) {
+        appendHistogramRow(out, "mon", monName, monCounts[monName]);
+    }
+    for (size_t species = 0; species < histogram.species.size(); species++) {
+        if (histogram.species[species].matches > 0) {
+            string value = "";
+            appendHex4(value, species);
+            appendHistogramRow(out, "species", value, histogram.species[species]);
+        }
+    }
+    for (size_t heldItem = 0; heldItem < histogram.heldItems.size(); heldItem++) {
+        if (histogram.heldItems[heldItem].matches > 0) {
+            string value = "";
+            appendHex4(value, heldItem);
+            appendHistogramRow(out, "item", value, histogram.heldItems[heldItem]);
+        }
+    }
+    for (int pokeball = 1; pokeball < 13; pokeball++) {
+        if (histogram.pokeballs[pokeball].matches > 0) {
+            appendHistogramRow(out, "ball", to_string(pokeball), histogram.pokeballs[pokeball]);
+        }
+    }
+    for (int egg = 0; egg < 2; egg++) {
+        if (histogram.eggs[egg].matches > 0) {
+            appendHistogramRow(out, "egg", to_string(egg), histogram.eggs[egg]);
+        }
+    }
+    ofstream histogramFile(histogramPath, ios::out | ios::trunc);
+    histogramFile << out;
+    return (bool)histogramFile;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MatchRecord.h"
+using namespace std;
+
+struct HistogramCount {
+    uint64_t matches = 0;
+    uint64_t aces = 0;
+};
+
+// Species and held items are 16 bit, so they are counted in flat
+// tables indexed by value rather than looked up in a map
+struct MatchHistogram {
+    HistogramCount total;
+    vector<HistogramCount> mons;
+    vector<HistogramCount> species;
+    vector<HistogramCount> heldItems;
+    HistogramCount pokeballs[13];
+    HistogramCount eggs[2];
+};
+
+const size_t HISTOGRAM_VALUES = 65536;
+
+class MatchAggregator {
+public:
+MatchAggregator(int monCount);
+MatchHistogram &local();
+MatchHistogram merged() const;
+
+private:
+int monCount_;
+mutable mutex mutex_;
+map<thread::id, unique_ptr<MatchHistogram>> histograms_;
+};
+
+void addMatchToHistogram(MatchHistogram &histogram, const MatchRecord &record);
+void mergeHistogram(MatchHistogram &histogram, const MatchHistogram &other);
+bool writeHistogramCsv(string histogramPath, const MatchHistogram &histogram, const vector<string> &enemyList);
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cstdint>
+#include <climits>
+#include <map>
+#include <string>
+#include <vector>
+#include "ChecksumKernel.h"
+#include "MatchEngine.h"
+#include "MonTable.h"
+#include "NumaTopology.h"
+#include "OtidTable.h"
+using namespace std;
+
+/* ******************************************************
+ * Purpose: Precomputes the per-half checksum tables for
+ *   every enemy mon.
+ *   The new checksum is a sum over the low 16 key bits
+ *   plus a sum over the high 16 key bits. Each half sum
+ *   is linear in the key bits (bit j contributes
+ *   2^j * (words - 2 * words with bit j set)), so a half
+ *   is stored as two 256 entry byte tables. Tables are
+ *   laid out [byte][value][mon] so one key reads four
+ *   contiguous rows covering every mon, padded so SIMD
+ *   kernels can read whole vectors.
+ *   The high half of data[9] holds the pokeball and is
+ *   left out of the tables. The ball only sets its bits
+ *   11-14, so for a key the ball term and the checksum
+ *   differ from ball 0's by ((t ^ b) - b) << 11, where t
+ *   is key bits 27-30. All 12 balls are then resolved by
+ *   one residue: base checksum - half sum - ball 0 term.
+ *   Its low 11 bits must be 0 and firstBalls_[t][top 5
+ *   bits] gives the first ball with that difference.
+ * ******************************************************
+ * Parameters:
+ *   monTable: compiled mon and pokeball records
+ * ******************************************************
+*/
+MatchEngine::MatchEngine(const MonTable &monTable) : monTable_(monTable) {
+    monCount_ = monTable.monCount;
+    stride_ = (monCount_ + KERNEL_LANE_PADDING - 1) / KERNEL_LANE_PADDING * KERNEL_LANE_PADDING;
+    kernel_ = detectChecksumKernel();
+    blockFrames_ = INT_MAX;
+    blockMons_ = monCount_;
+    halfSums_.assign(4 * 256 * stride_, 0);
+    baseHi_.assign(stride_, 0);
+    baseChecksums_.assign(stride_, 0);
+    firstBalls_.assign(16 * 32, 0);
+    for (int keyBits = 0; keyBits < 16; keyBits++) {
+        for (int ball = 12; ball >= 1; ball--) {
+            firstBalls_[keyBits * 32 + (((keyBits ^ ball) - ball) & 31)] = ball;
+        }
+    }
+
+    for (int monIndex = 0; monIndex < monCount_; monIndex++) {
+        const MonRecord &record = monTable.record(monIndex, 1);
+
+        // Count set bits per position for each half
+        long long loBase = 0;
+        long long hiBase = 0;
+        int loBits[16] = {};
+        int hiBits[16] = {};
+        for (int dataIndex = 0; dataIndex < 12; dataIndex++) {
+            long long lo = record.data[dataIndex] % 65536;
+            loBase += lo;
+            for (int bit = 0; bit < 16; bit++) {
+                loBits[bit] += (lo >> bit) & 1;
+            }
+            if (dataIndex == 9) {
+                continue;
+            }
+            long long hi = record.data[dataIndex] / 65536;
+            hiBase += hi;
+            for (int bit = 0; bit < 16; bit++) {
+                hiBits[bit] += (hi >> bit) & 1;
+            }
+        }
+
+        // Byte tables: 0 = key low byte, 1 = key bits 8-15, 2 = key bits 16-23, 3 = key bits 24-31
+        for (int table = 0; table < 4; table++) {
+            int* bitCounts = table < 2 ? loBits : hiBits;
+            int words = table < 2 ? 12 : 11;
+            int bitOffset = (table % 2) * 8;
+            for (int value = 0; value < 256; value++) {
+                long long sum = table == 0 ? loBase + hiBase : 0;
+                for (int bit = 0; bit < 8; bit++) {
+                    if ((value >> bit) & 1) {
+                        sum += (1LL << (bit + bitOffset)) * (words - 2 * bitCounts[bit + bitOffset]);
+                    }
+                }
+                halfSums_[(table * 256 + value) * stride_ + monIndex] = (uint16_t)sum;
+            }
+        }
+
+        // Ball 0: data[9] and the checksum with the pokeball bits cleared
+        baseHi_[monIndex] = (uint16_t)(record.data[9] / 65536) & ~POKEBALL_HI_MASK;
+        baseChecksums_[monIndex] = record.checksum - (record.pokeball << POKEBALL_SHIFT);
+    }
+}
+
+/* ******************************************************
+ * Purpose: Joins one player key against the enemy keys
+ *   of a frame range and reports the first matching
+ *   pokeball of every matching mon
+ * ******************************************************
+ * Parameters:
+ *   playerKey: Player key
+ *   enemyKeys: enemy key for each frame
+ *   frameStart: first frame to calc
+ *   frameEnd: frame to stop before
+ *   matches: Outputs matches in frame, mon order
+ * ******************************************************
+*/
+void MatchEngine::findMatches(long long playerKey, const vector<long long> &enemyKeys, int frameStart, int frameEnd, vector<EngineMatch> &matches) const {
+    const uint16_t* halfSums = nodeHalfSums_.empty() ? halfSums_.data() : nodeHalfSums_[currentNumaNode(topology_)].data();
+    int blockMons = blockMons_ < monCount_ ? blockMons_ : monCount_;
+    for (int blockStart = frameStart, blockEnd = frameStart; blockStart < frameEnd; blockStart = blockEnd) {
+        blockEnd = frameEnd - blockStart > blockFrames_ ? blockStart + blockFrames_ : frameEnd;
+        size_t firstMatch = matches.size();
+        for (int monBase = 0; monBase < monCount_; monBase += blockMons) {
+            KernelTables tables = { halfSums + monBase, baseHi_.data() + monBase, baseChecksums_.data() + monBase, firstBalls_.data(),
+                monBase, monCount_ - monBase > blockMons ? blockMons : monCount_ - monBase, stride_ };
+            findMatchesKernel(kernel_, tables, playerKey, enemyKeys.data(), blockStart, blockEnd, matches);
+        }
+        // Each mon block reports in frame order, merge them back to frame, mon order
+        if (blockMons < monCount_) {
+            stable_sort(matches.begin() + firstMatch, matches.end(), [](const EngineMatch &left, const EngineMatch &right) {
+                return left.frame < right.frame;
+                });
+        }
+    }
+}
+
+/* ******************************************************
+ * Purpose: Checks a single mon against one key
+ * ******************************************************
+ * Parameters:
+ *   keysXored: player key ^ enemy key
+ *   monIndex: index into enemyList
+ * ******************************************************
+ * Returns: first matching pokeball, 0 if none match
+ * ******************************************************
+*/
+int MatchEngine::firstPokeball(long long keysXored, int monIndex) const {
+    int keyLo = keysXored % 65536;
+    int keyHi = keysXored / 65536;
+    uint16_t halfSum = halfSums_[((0 * 256) + (keyLo & 255)) * stride_ + monIndex]
+        + halfSums_[((1 * 256) + (keyLo >> 8)) * stride_ + monIndex]
+        + halfSums_[((2 * 256) + (keyHi & 255)) * stride_ + monIndex]
+        + halfSums_[((3 * 256) + (keyHi >> 8)) * stride_ + monIndex];
+    uint16_t residue = baseChecksums_[monIndex] - halfSum - ((keyHi ^ baseHi_[monIndex]) & ~POKEBALL_HI_MASK);
+    if ((residue & BALL_RESIDUE_MASK) != 0) {
+        return 0;
+    }
+    return firstBalls_[((keyHi >> POKEBALL_SHIFT) & 15) * 32 + (residue >> POKEBALL_SHIFT)];
+}
+
+/* ******************************************************
+ * Purpose: Sets the loop blocking of findMatches. Frames
+ *   are walked in blocks, and each block is swept one
+ *   block of mons at a time, so that block's slice of the
+ *   half sum tables stays in cache for the whole frame
+ *   block. Helps when the tables (about 2 KB per mon)
+ *   don't fit in L2.
+ * ******************************************************
+ * Parameters:
+ *   blockFrames: frames per block, 0 for no blocking
+ *   blockMons: mons per block, rounded up to a whole
+ *     number of kernel lanes, 0 for every mon at once
+ * ******************************************************
+*/
+void MatchEngine::setBlocking(int blockFrames, int blockMons) {
+    blockFrames_ = blockFrames > 0 ? blockFrames : INT_MAX;
+    blockMons_ = blockMons > 0 ? (blockMons + KERNEL_LANE_PADDING - 1) / KERNEL_LANE_PADDING * KERNEL_LANE_PADDING : monCount_;
+}
+
+/* ******************************************************
+ * Purpose: Gives every NUMA node its own copy of the half
+ *   sum tables, written by a thread on that node so the
+ *   pages are local. findMatches reads the copy of the
+ *   node it runs on.
+ * ******************************************************
+ * Parameters:
+ *   topology: NUMA nodes and their CPUs
+ * ******************************************************
+*/
+void MatchEngine::placeOnNumaNodes(const NumaTopology &topology) {
+    topology_ = topology;
+    nodeHalfSums_ = vector<vector<uint16_t>>(topology.nodeCpus.size());
+    for (size_t node = 0; node < topology.nodeCpus.size(); node++) {
+        runOnNumaNode(topology, node, [this, node]() {
+            nodeHalfSums_[node] = halfSums_;
+            });
+    }
+}
+
+int MatchEngine::monCount() const {
+    return monCount_;
+}
+
+const MonTable &MatchEngine::monTable() const {
+    return monTable_;
+}
+
+/* ******************************************************
+ * Purpose: Overrides the detected kernel
+ * ******************************************************
+ * Parameters:
+ *   kernel: kernel to use, must be supported
+ * ******************************************************
+*/
+void MatchEngine::setKernel(ChecksumKernel kernel) {
+    kernel_ = kernel;
+}
+
+ChecksumKernel MatchEngine::kernel() const {
+    return kernel_;
+}
+
+/* ******************************************************
+ * Purpose: Calculates the enemy key of every frame once
+ *   and buckets frames by each 16 bit key half so a
+ *   fixed key half can be looked up directly
+ * ******************************************************
+ * Parameters:
+ *   otidTable: TID and SID per advance
+ *   frames: num frames to calc
+ *   pid: PID used for both keys
+ * ******************************************************
+*/
+EnemyKeyIndex buildEnemyKeyIndex(const OtidTable &otidTable, int frames, long long pid) {
+    EnemyKeyIndex enemyKeyIndex = EnemyKeyIndex();
+    enemyKeyIndex.keys = vector<long long>(frames);
+    enemyKeyIndex.loStart = vector<int>(65537, 0);
+    enemyKeyIndex.hiStart = vector<int>(65537, 0);
+    enemyKeyIndex.loFrames = vector<int>(frames);
+    enemyKeyIndex.hiFrames = vector<int>(frames);
+
+    for (int frame = 0; frame < frames; frame++) {
+        long long enemyLongLong = ((long long)otidTable.tids[frame] << 16) + otidTable.sids[frame];
+        long long enemyKey = pid ^ enemyLongLong;
+        enemyKeyIndex.keys[frame] = enemyKey;
+        enemyKeyIndex.loStart[enemyKey % 65536 + 1]++;
+        enemyKeyIndex.hiStart[enemyKey / 65536 % 65536 + 1]++;
+    }
+    for (int half = 0; half < 65536; half++) {
+        enemyKeyIndex.loStart[half + 1] += enemyKeyIndex.loStart[half];
+        enemyKeyIndex.hiStart[half + 1] += enemyKeyIndex.hiStart[half];
+    }
+
+    // Frames stay in ascending order within each bucket
+    vector<int> loNext(enemyKeyIndex.loStart.begin(), enemyKeyIndex.loStart.end() - 1);
+    vector<int> hiNext(enemyKeyIndex.hiStart.begin(), enemyKeyIndex.hiStart.end() - 1);
+    for (int frame = 0; frame < frames; frame++) {
+        long long enemyKey = enemyKeyIndex.keys[frame];
+        enemyKeyIndex.loFrames[loNext[enemyKey % 65536]++] = frame;
+        enemyKeyIndex.hiFrames[hiNext[enemyKey / 65536 % 65536]++] = frame;
+    }
+    return enemyKeyIndex;
+}
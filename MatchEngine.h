@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "ChecksumKernel.h"
+#include "MonTable.h"
+#include "NumaTopology.h"
+#include "OtidTable.h"
+using namespace std;
+
+class MatchEngine {
+public:
+MatchEngine(const MonTable &monTable);
+void findMatches(long long playerKey, const vector<long long> &enemyKeys, int frameStart, int frameEnd, vector<EngineMatch> &matches) const;
+int firstPokeball(long long keysXored, int monIndex) const;
+int monCount() const;
+const MonTable &monTable() const;
+void setKernel(ChecksumKernel kernel);
+void setBlocking(int blockFrames, int blockMons);
+void placeOnNumaNodes(const NumaTopology &topology);
+ChecksumKernel kernel() const;
+
+private:
+const MonTable &monTable_;
+int monCount_;
+int stride_;
+ChecksumKernel kernel_;
+int blockFrames_;
+int blockMons_;
+vector<uint16_t> halfSums_;
+vector<uint16_t> baseHi_;
+vector<uint16_t> baseChecksums_;
+vector<uint8_t> firstBalls_;
+NumaTopology topology_;
+vector<vector<uint16_t>> nodeHalfSums_;
+};
+
+struct EnemyKeyIndex {
+    vector<long long> keys;
+    vector<int> loStart;
+    vector<int> loFrames;
+    vector<int> hiStart;
+    vector<int> hiFrames;
+};
+
+EnemyKeyIndex buildEnemyKeyIndex(const OtidTable &otidTable, int frames, long long pid);
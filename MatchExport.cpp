@@ -0,0 +1,198 @@
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "MatchExport.h"
+#include "MatchRecord.h"
+#include "OtidTable.h"
+#include "Profiler.h"
+#include "ResultSink.h"
+#include "ThreadPool.h"
+using namespace std;
+
+const string CSV_HEADER = "Player frame,Enemy Frame,Player TID/SID,Enemy TID/SID,Species,Held Item,Moves,Pokeball,Egg,Enemy Mon";
+const uint64_t EXPORT_CHUNK_RECORDS = 16384;
+const size_t MAX_BUFFERED_EXPORT = 64 * 1024 * 1024;
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+/* ******************************************************
+ * Purpose: Appends a 16 bit value as 0x and 4 lowercase
+ *   hex digits
+ * ******************************************************
+ * Parameters:
+ *   out: string to append to
+ *   value: value to format, only the low 16 bits are used
+ * ******************************************************
+*/
+void appendHex4(string &out, uint32_t value) {
+    char hex[6] = { '0', 'x',
+        HEX_DIGITS[(value >> 12) & 15], HEX_DIGITS[(value >> 8) & 15],
+        HEX_DIGITS[(value >> 4) & 15], HEX_DIGITS[value & 15] };
+    out.append(hex, sizeof(hex));
+}
+
+/* ******************************************************
+ * Purpose: Appends a string as a quoted JSON string
+ * ******************************************************
+ * Parameters:
+ *   out: string to append to
+ *   value: string to quote
+ * ******************************************************
+*/
+void appendJsonString(string &out, const string &value) {
+    out += '"';
+    for (char character : value) {
+        if (character == '"' || character == '\\') {
+            out += '\\';
+        }
+        out += character;
+    }
+    out += '"';
+}
+
+/* ******************************************************
+ * Purpose: Formats a record as a combinedMatches.csv row
+ * ******************************************************
+ * Parameters:
+ *   record: match record
+ *   otidTable: TID and SID per advance
+ *   enemyList: vector of enemy mons
+ *   out: Outputs the row with a trailing newline
+ * ******************************************************
+*/
+void formatMatchCsv(const MatchRecord &record, const OtidTable &otidTable, const vector<string> &enemyList, string &out) {
+    out += to_string(record.tid);                       // Player Frame
+    out += ',';
+    out += to_string(record.frame);                     // Enemy Frame
+    out += ',';
+    out += to_string(otidTable.tids[record.tid]);       // Player TID
+    out += ' ';
+    out += to_string(otidTable.sids[record.tid]);       // Player SID
+    out += ',';
+    out += to_string(otidTable.sids[record.frame]);     // Enemy TID
+    out += ' ';
+    out += to_string(otidTable.tids[record.frame]);     // Enemy SID
+    out += ',';
+    appendHex4(out, record.keyXorData0);                // Species
+    out += ',';
+    appendHex4(out, record.keyXorData0 >> 16);          // Held Item
+    out += ',';
+    appendHex4(out, record.keyXorData3);                // Moves 1
+    out += ' ';
+    appendHex4(out, record.keyXorData3 >> 16);          // Moves 2
+    out += ' ';
+    appendHex4(out, record.keyXorData4);                // Moves 3
+    out += ' ';
+    appendHex4(out, record.keyXorData4 >> 16);          // Moves 4
+    out += ',';
+    out += to_string(record.pokeball);                  // Pokeball
+    out += ',';
+    out += (char)('0' + ((record.keyXorData10 >> 30) & 1)); // Egg
+    out += ',';
+    out += enemyList[record.monIndex];                  // Enemy Mon
+    out += '\n';
+}
+
+/* ******************************************************
+ * Purpose: Formats a record as one line of JSON with the
+ *   same fields as the csv
+ * ******************************************************
+ * Parameters:
+ *   record: match record
+ *   otidTable: TID and SID per advance
+ *   enemyList: vector of enemy mons
+ *   out: Outputs the object with a trailing newline
+ * ******************************************************
+*/
+void formatMatchJson(const MatchRecord &record, const OtidTable &otidTable, const vector<string> &enemyList, string &out) {
+    out += "{\"playerFrame\":" + to_string(record.tid);
+    out += ",\"enemyFrame\":" + to_string(record.frame);
+    out += ",\"playerTid\":" + to_string(otidTable.tids[record.tid]);
+    out += ",\"playerSid\":" + to_string(otidTable.sids[record.tid]);
+    out += ",\"enemyTid\":" + to_string(otidTable.sids[record.frame]);
+    out += ",\"enemySid\":" + to_string(otidTable.tids[record.frame]);
+    out += ",\"species\":\"";
+    appendHex4(out, record.keyXorData0);
+    out += "\",\"heldItem\":\"";
+    appendHex4(out, record.keyXorData0 >> 16);
+    out += "\",\"moves\":[\"";
+    appendHex4(out, record.keyXorData3);
+    out += "\",\"";
+    appendHex4(out, record.keyXorData3 >> 16);
+    out += "\",\"";
+    appendHex4(out, record.keyXorData4);
+    out += "\",\"";
+    appendHex4(out, record.keyXorData4 >> 16);
+    out += "\"],\"pokeball\":" + to_string(record.pokeball);
+    out += ",\"egg\":" + to_string((record.keyXorData10 >> 30) & 1);
+    out += (record.flags & MATCH_FLAG_ACE) ? ",\"ace\":true" : ",\"ace\":false";
+    out += ",\"enemyMon\":";
+    appendJsonString(out, enemyList[record.monIndex]);
+    out += "}\n";
+}
+
+/* ******************************************************
+ * Purpose: Renders a binary match file, or a TID and
+ *   frame slice of it, as csv or JSON. Chunks of records
+ *   are formatted in parallel and written in order.
+ * ******************************************************
+ * Parameters:
+ *   matchBinaryPath: binary match file
+ *   otidTable: TID and SID per advance
+ *   enemyList: vector of enemy mons
+ *   format: csv or JSON
+ *   slice: inclusive TID and frame ranges to export
+ *   threads: number of formatting threads
+ *   matchPath: output for every record
+ *   acePath: output for ace records, empty for none
+ * ******************************************************
+*/
+bool exportMatches(string matchBinaryPath, const OtidTable &otidTable, const vector<string> &enemyList, ExportFormat format, ExportSlice slice, int threads, string matchPath, string acePath) {
+    ifstream matchFile(matchBinaryPath, ios::binary);
+    MatchFileHeader header = MatchFileHeader();
+    uint64_t recordCount = 0;
+    if (!readMatchFileHeader(matchFile, header, recordCount) || header.monCount != enemyList.size()) {
+        return false;
+    }
+
+    uint64_t firstRecord = lowerBoundTid(matchFile, recordCount, slice.tidStart);
+    uint64_t lastRecord = slice.tidEnd == INT_MAX ? recordCount : lowerBoundTid(matchFile, recordCount, (long long)slice.tidEnd + 1);
+    uint64_t chunkCount = lastRecord > firstRecord ? (lastRecord - firstRecord + EXPORT_CHUNK_RECORDS - 1) / EXPORT_CHUNK_RECORDS : 0;
+
+    string textHeader = format == EXPORT_CSV ? CSV_HEADER + "\n" : "";
+    ResultSink sink(matchPath, acePath, textHeader, textHeader, ios::openmode(), chunkCount, MAX_BUFFERED_EXPORT);
+    ThreadPool pool(threads);
+    for (uint64_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++) {
+        pool.enqueue([chunkIndex, firstRecord, lastRecord, format, slice, matchBinaryPath, &otidTable, &enemyList, &sink]() {
+            ProfileScope scope("exportChunk");
+            uint64_t chunkStart = firstRecord + chunkIndex * EXPORT_CHUNK_RECORDS;
+            uint64_t chunkEnd = chunkStart + EXPORT_CHUNK_RECORDS < lastRecord ? chunkStart + EXPORT_CHUNK_RECORDS : lastRecord;
+            vector<MatchRecord> records = vector<MatchRecord>(chunkEnd - chunkStart);
+            ifstream chunkFile(matchBinaryPath, ios::binary);
+            chunkFile.seekg(sizeof(MatchFileHeader) + chunkStart * sizeof(MatchRecord));
+            chunkFile.read((char*)records.data(), records.size() * sizeof(MatchRecord));
+
+            TileOutput output = sink.acquire();
+            for (const MatchRecord &record : records) {
+                if ((long long)record.frame < slice.frameStart || (long long)record.frame > slice.frameEnd) {
+                    continue;
+                }
+                if (format == EXPORT_JSON) {
+                    formatMatchJson(record, otidTable, enemyList, output.matches);
+                    continue;
+                }
+                size_t rowStart = output.matches.size();
+                formatMatchCsv(record, otidTable, enemyList, output.matches);
+                if (record.flags & MATCH_FLAG_ACE) {
+                    output.aces.append(output.matches, rowStart, string::npos);
+                }
+            }
+            sink.submit(chunkIndex, move(output));
+            });
+    }
+    pool.stopAndWait();
+    sink.close();
+    return true;
+}
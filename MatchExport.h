@@ -0,0 +1,28 @@
+#pragma once
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MatchRecord.h"
+#include "OtidTable.h"
+using namespace std;
+
+enum ExportFormat {
+    EXPORT_CSV,
+    EXPORT_JSON
+};
+
+struct ExportSlice {
+    int tidStart = 0;
+    int tidEnd = INT_MAX;
+    int frameStart = 0;
+    int frameEnd = INT_MAX;
+};
+
+extern const string CSV_HEADER;
+
+void appendHex4(string &out, uint32_t value);
+void appendJsonString(string &out, const string &value);
+void formatMatchCsv(const MatchRecord &record, const OtidTable &otidTable, const vector<string> &enemyList, string &out);
+void formatMatchJson(const MatchRecord &record, const OtidTable &otidTable, const vector<string> &enemyList, string &out);
+bool exportMatches(string matchBinaryPath, const OtidTable &otidTable, const vector<string> &enemyList, ExportFormat format, ExportSlice slice, int threads, string matchPath, string acePath);
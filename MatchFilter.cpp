@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "MatchFilter.h"
+using namespace std;
+
+const int ACE_SPECIES = 39710;
+
+/* ******************************************************
+ * Purpose: Sets a single valued predicate, rejecting
+ *   two different values for the same field
+ * ******************************************************
+ * Parameters:
+ *   field: predicate to set
+ *   value: parsed value
+ *   name: predicate name for errors
+ * ******************************************************
+*/
+void setFilterField(int &field, int value, string name) {
+    if (field >= 0 && field != value) {
+        throw invalid_argument("conflicting values for " + name);
+    }
+    field = value;
+}
+
+/* ******************************************************
+ * Purpose: Parses a filter string such as
+ *   "ace,item=0x0000,move=0x21,egg=0,ball=4"
+ *   Terms are joined with AND. Values can be decimal or
+ *   0x prefixed hex and compare against the Species,
+ *   Held Item, Moves, Egg and Pokeball output columns.
+ * ******************************************************
+ * Parameters:
+ *   filterString: comma separated filter terms
+ * ******************************************************
+*/
+MatchFilter parseMatchFilter(string filterString) {
+    MatchFilter filter = MatchFilter();
+    const string DELIMITER = ",";
+    size_t termStart = 0;
+
+    while (termStart < filterString.length()) {
+        size_t termEnd = filterString.find(DELIMITER, termStart);
+        if (termEnd == string::npos) {
+            termEnd = filterString.length();
+        }
+        string term = filterString.substr(termStart, termEnd - termStart);
+        termStart = termEnd + 1;
+        if (term.empty()) {
+            continue;
+        }
+        if (term == "ace") {
+            setFilterField(filter.species, ACE_SPECIES, "species");
+            filter.active = true;
+            continue;
+        }
+
+        size_t equalsIndex = term.find("=");
+        if (equalsIndex == string::npos) {
+            throw invalid_argument("unknown filter term " + term);
+        }
+        string name = term.substr(0, equalsIndex);
+        int value = stoi(term.substr(equalsIndex + 1), 0, 0);
+        if (name == "species" || name == "item" || name == "move") {
+            if (value < 0 || value > 65535) {
+                throw invalid_argument(name + " must be between 0 and 0xffff");
+            }
+        }
+
+        if (name == "species") {
+            setFilterField(filter.species, value, name);
+        } else if (name == "item") {
+            setFilterField(filter.heldItem, value, name);
+        } else if (name == "move") {
+            filter.moves.push_back(value);
+        } else if (name == "egg") {
+            if (value != 0 && value != 1) {
+                throw invalid_argument("egg must be 0 or 1");
+            }
+            setFilterField(filter.egg, value, name);
+        } else if (name == "ball") {
+            if (value < 1 || value > 12) {
+                throw invalid_argument("ball must be between 1 and 12");
+            }
+            setFilterField(filter.pokeball, value, name);
+        } else {
+            throw invalid_argument("unknown filter term " + term);
+        }
+        filter.active = true;
+    }
+    return filter;
+}
+
+/* ******************************************************
+ * Purpose: Checks a match against every filter term
+ *   before any output is built
+ * ******************************************************
+ * Parameters:
+ *   filter: parsed filter
+ *   record: matching mon and pokeball record
+ *   keysXored: player key ^ enemy key
+ * ******************************************************
+*/
+bool matchPassesFilter(const MatchFilter &filter, const MonRecord &record, long long keysXored) {
+    long long keyXorData0 = keysXored ^ record.data[0];
+    if (filter.species >= 0 && keyXorData0 % 65536 != filter.species) {
+        return false;
+    }
+    if (filter.heldItem >= 0 && keyXorData0 / 65536 != filter.heldItem) {
+        return false;
+    }
+    long long keyXorData3 = keysXored ^ record.data[3];
+    long long keyXorData4 = keysXored ^ record.data[4];
+    for (int move : filter.moves) {
+        if (keyXorData3 % 65536 != move && keyXorData3 / 65536 != move
+            && keyXorData4 % 65536 != move && keyXorData4 / 65536 != move) {
+            return false;
+        }
+    }
+    if (filter.egg >= 0 && (((keysXored ^ record.data[10]) >> 30) & 1) != filter.egg) {
+        return false;
+    }
+    if (filter.pokeball >= 0 && record.pokeball != filter.pokeball) {
+        return false;
+    }
+    return true;
+}
+
+/* ******************************************************
+ * Purpose: Finds the matches of one player key that pass
+ *   the filter.
+ *   Species, held item and move terms each fix one 16 bit
+ *   half of keysXored for a mon, so only frames whose
+ *   enemy key has that half are looked up in the enemy
+ *   key index and checked. Filters without such a term
+ *   check every frame and drop rows afterwards.
+ * ******************************************************
+ * Parameters:
+ *   engine: precomputed mon checksum tables
+ *   enemyKeyIndex: enemy keys bucketed by key half
+ *   playerKey: Player key
+ *   frameStart: first frame to calc
+ *   frameEnd: frame to stop before
+ *   filter: parsed filter
+ *   matches: Outputs matches in frame, mon order
+ * ******************************************************
+*/
+void findFilteredMatches(const MatchEngine &engine, const EnemyKeyIndex &enemyKeyIndex, long long playerKey, int frameStart, int frameEnd, const MatchFilter &filter, vector<EngineMatch> &matches) {
+    const MonTable &monTable = engine.monTable();
+    bool pushdown = filter.species >= 0 || filter.heldItem >= 0 || !filter.moves.empty();
+    if (!pushdown) {
+        vector<EngineMatch> unfilteredMatches = vector<EngineMatch>();
+        engine.findMatches(playerKey, enemyKeyIndex.keys, frameStart, frameEnd, unfilteredMatches);
+        for (const EngineMatch &engineMatch : unfilteredMatches) {
+            const MonRecord &record = monTable.record(engineMatch.monIndex, engineMatch.pokeball);
+            if (matchPassesFilter(filter, record, playerKey ^ enemyKeyIndex.keys[engineMatch.frame])) {
+                matches.push_back(engineMatch);
+            }
+        }
+        return;
+    }
+
+    size_t firstMatch = matches.size();
+    int playerLo = playerKey % 65536;
+    int playerHi = playerKey / 65536 % 65536;
+    vector<int> candidateFrames = vector<int>();
+    for (int monIndex = 0; monIndex < engine.monCount(); monIndex++) {
+        const uint32_t* data = monTable.record(monIndex, 1).data;
+
+        // Each term fixes the low and/or high half of keysXored, -1 leaves a half free
+        vector<pair<int, int>> terms = vector<pair<int, int>>();
+        int fixedLo = filter.species >= 0 ? filter.species ^ (int)(data[0] % 65536) : -1;
+        int fixedHi = filter.heldItem >= 0 ? filter.heldItem ^ (int)(data[0] / 65536) : -1;
+        if (filter.moves.empty()) {
+            terms.push_back(pair<int, int>(fixedLo, fixedHi));
+        } else {
+            // The first move can be in any of the four move slots
+            int move = filter.moves[0];
+            pair<int, int> moveTerms[4] = {
+                pair<int, int>(move ^ (int)(data[3] % 65536), -1),
+                pair<int, int>(-1, move ^ (int)(data[3] / 65536)),
+                pair<int, int>(move ^ (int)(data[4] % 65536), -1),
+                pair<int, int>(-1, move ^ (int)(data[4] / 65536))
+            };
+            for (pair<int, int> moveTerm : moveTerms) {
+                if (fixedLo >= 0 && moveTerm.first >= 0 && fixedLo != moveTerm.first) {
+                    continue;
+                }
+                if (fixedHi >= 0 && moveTerm.second >= 0 && fixedHi != moveTerm.second) {
+                    continue;
+                }
+                terms.push_back(pair<int, int>(max(fixedLo, moveTerm.first), max(fixedHi, moveTerm.second)));
+            }
+        }
+
+        candidateFrames.clear();
+        for (pair<int, int> term : terms) {
+            bool useLo = term.first >= 0;
+            int bucket = useLo ? playerLo ^ term.first : playerHi ^ term.second;
+            const vector<int> &bucketStart = useLo ? enemyKeyIndex.loStart : enemyKeyIndex.hiStart;
+            const vector<int> &bucketFrames = useLo ? enemyKeyIndex.loFrames : enemyKeyIndex.hiFrames;
+            for (int bucketIndex = bucketStart[bucket]; bucketIndex < bucketStart[bucket + 1]; bucketIndex++) {
+                int frame = bucketFrames[bucketIndex];
+                if (frame < frameStart || frame >= frameEnd) {
+                    continue;
+                }
+                if (useLo && term.second >= 0 && enemyKeyIndex.keys[frame] / 65536 % 65536 != (playerHi ^ term.second)) {
+                    continue;
+                }
+                candidateFrames.push_back(frame);
+            }
+        }
+        sort(candidateFrames.begin(), candidateFrames.end());
+        candidateFrames.erase(unique(candidateFrames.begin(), candidateFrames.end()), candidateFrames.end());
+
+        for (int frame : candidateFrames) {
+            long long keysXored = playerKey ^ enemyKeyIndex.keys[frame];
+            int pokeball = engine.firstPokeball(keysXored, monIndex);
+            if (pokeball == 0) {
+                continue;
+            }
+            if (matchPassesFilter(filter, monTable.record(monIndex, pokeball), keysXored)) {
+                matches.push_back({ frame, monIndex, pokeball });
+            }
+        }
+    }
+
+    sort(matches.begin() + firstMatch, matches.end(), [](const EngineMatch &a, const EngineMatch &b) {
+        return a.frame != b.frame ? a.frame < b.frame : a.monIndex < b.monIndex;
+        });
+}
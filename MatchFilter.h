@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "MatchEngine.h"
+using namespace std;
+
+struct MatchFilter {
+    bool active = false;
+    int species = -1;
+    int heldItem = -1;
+    vector<int> moves;
+    int egg = -1;
+    int pokeball = -1;
+};
+
+MatchFilter parseMatchFilter(string filterString);
+bool matchPassesFilter(const MatchFilter &filter, const MonRecord &record, long long keysXored);
+void findFilteredMatches(const MatchEngine &engine, const EnemyKeyIndex &enemyKeyIndex, long long playerKey, int frameStart, int frameEnd, const MatchFilter &filter, vector<EngineMatch> &matches);
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "MatchMerge.h"
+#include "MatchRecord.h"
+#include "ResultSink.h"
+#include "ThreadPool.h"
+using namespace std;
+
+const int MERGE_BLOCK_TIDS = 256;
+const size_t MERGE_READ_RECORDS = 4096;
+const size_t MAX_BUFFERED_MERGE = 64 * 1024 * 1024;
+
+/* ******************************************************
+ * Purpose: Gathers one block of TIDs from sorted binary
+ *   match files and hands it to the sink in TID, frame,
+ *   mon order, a match found more than once kept once
+ * ******************************************************
+ * Parameters:
+ *   inputPaths: binary match files to read
+ *   blockIndex: index of the block in the sink
+ *   blockStart: first TID of the block (inclusive)
+ *   blockEnd: last TID of the block (inclusive)
+ *   transform: adds a record read from an input to the
+ *     block, as it is or changed, any number of times
+ *   sink: sink the block is submitted to
+ * ******************************************************
+*/
+void gatherMatchBlock(const vector<string> &inputPaths, size_t blockIndex, long long blockStart, long long blockEnd, function<void(size_t inputIndex, MatchRecord record, vector<MatchRecord> &blockRecords)> transform, ResultSink &sink) {
+    vector<MatchRecord> blockRecords = vector<MatchRecord>();
+    vector<MatchRecord> readRecords = vector<MatchRecord>(MERGE_READ_RECORDS);
+
+    for (size_t inputIndex = 0; inputIndex < inputPaths.size(); inputIndex++) {
+        ifstream inputFile(inputPaths[inputIndex], ios::binary);
+        MatchFileHeader header = MatchFileHeader();
+        uint64_t recordCount = 0;
+        if (!readMatchFileHeader(inputFile, header, recordCount)) {
+            continue;
+        }
+        uint64_t recordIndex = lowerBoundTid(inputFile, recordCount, blockStart);
+        inputFile.seekg(sizeof(MatchFileHeader) + recordIndex * sizeof(MatchRecord));
+        bool blockDone = false;
+        while (recordIndex < recordCount && !blockDone) {
+            size_t chunkRecords = min((uint64_t)MERGE_READ_RECORDS, recordCount - recordIndex);
+            inputFile.read((char*)readRecords.data(), chunkRecords * sizeof(MatchRecord));
+            recordIndex += chunkRecords;
+            for (size_t chunkIndex = 0; chunkIndex < chunkRecords; chunkIndex++) {
+                if (readRecords[chunkIndex].tid > blockEnd) {
+                    blockDone = true;
+                    break;
+                }
+                transform(inputIndex, readRecords[chunkIndex], blockRecords);
+            }
+        }
+    }
+
+    sort(blockRecords.begin(), blockRecords.end(), [](const MatchRecord &a, const MatchRecord &b) {
+        if (a.tid != b.tid) {
+            return a.tid < b.tid;
+        }
+        return a.frame != b.frame ? a.frame < b.frame : a.monIndex < b.monIndex;
+        });
+    blockRecords.erase(unique(blockRecords.begin(), blockRecords.end(), [](const MatchRecord &a, const MatchRecord &b) {
+        return a.tid == b.tid && a.frame == b.frame && a.monIndex == b.monIndex;
+        }), blockRecords.end());
+
+    TileOutput output = sink.acquire();
+    output.matches.append((const char*)blockRecords.data(), blockRecords.size() * sizeof(MatchRecord));
+    sink.submit(blockIndex, move(output));
+}
+
+/* ******************************************************
+ * Purpose: Merges binary match files, such as the shards
+ *   of a run, into one file in TID, frame, mon order.
+ *   Blocks of TIDs are read from every input and sorted
+ *   in parallel. A match found in more than one input,
+ *   as with overlapping shards, is kept once.
+ * ******************************************************
+ * Parameters:
+ *   inputPaths: binary match files to merge
+ *   threads: number of threads
+ *   outputPath: merged binary match file
+ * ******************************************************
+*/
+bool mergeMatchFiles(const vector<string> &inputPaths, int threads, string outputPath) {
+    MatchFileHeader firstHeader = MatchFileHeader();
+    long long tidStart = -1;
+    long long tidEnd = -1;
+    for (size_t inputIndex = 0; inputIndex < inputPaths.size(); inputIndex++) {
+        ifstream inputFile(inputPaths[inputIndex], ios::binary);
+        MatchFileHeader header = MatchFileHeader();
+        uint64_t recordCount = 0;
+        if (!readMatchFileHeader(inputFile, header, recordCount)) {
+            cout << inputPaths[inputIndex] << " is not a match file." << endl;
+            return false;
+        }
+        if (inputIndex == 0) {
+            firstHeader = header;
+        } else if (header.monCount != firstHeader.monCount || header.pid != firstHeader.pid) {
+            cout << inputPaths[inputIndex] << " is from a different PID or enemy data than " << inputPaths[0] << endl;
+            return false;
+        }
+        if (recordCount == 0) {
+            continue;
+        }
+
+        // Records are sorted, so the first and last hold the TID range
+        MatchRecord record = MatchRecord();
+        inputFile.read((char*)&record, sizeof(record));
+        tidStart = tidStart < 0 ? record.tid : min(tidStart, (long long)record.tid);
+        inputFile.seekg(sizeof(MatchFileHeader) + (recordCount - 1) * sizeof(MatchRecord));
+        inputFile.read((char*)&record, sizeof(record));
+        tidEnd = max(tidEnd, (long long)record.tid);
+    }
+
+    string header = matchFileHeaderBytes(firstHeader.monCount, firstHeader.pid);
+    size_t blockCount = tidStart < 0 ? 0 : (tidEnd - tidStart) / MERGE_BLOCK_TIDS + 1;
+    ResultSink sink(outputPath, "", header, "", ios::binary, blockCount, MAX_BUFFERED_MERGE);
+    ThreadPool pool(threads);
+    for (size_t blockIndex = 0; blockIndex < blockCount; blockIndex++) {
+        pool.enqueue([blockIndex, tidStart, &inputPaths, &sink]() {
+            long long blockStart = tidStart + (long long)blockIndex * MERGE_BLOCK_TIDS;
+            gatherMatchBlock(inputPaths, blockIndex, blockStart, blockStart + MERGE_BLOCK_TIDS - 1, [](size_t, MatchRecord record, vector<MatchRecord> &blockRecords) {
+                blockRecords.push_back(record);
+                }, sink);
+            });
+    }
+    pool.stopAndWait();
+    sink.close();
+    return true;
+}
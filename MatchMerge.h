@@ -0,0 +1,11 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "MatchRecord.h"
+#include "ResultSink.h"
+using namespace std;
+
+void gatherMatchBlock(const vector<string> &inputPaths, size_t blockIndex, long long blockStart, long long blockEnd, function<void(size_t inputIndex, MatchRecord record, vector<MatchRecord> &blockRecords)> transform, ResultSink &sink);
+bool mergeMatchFiles(const vector<string> &inputPaths, int threads, string outputPath);
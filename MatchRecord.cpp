@@ -0,0 +1,153 @@
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "MatchRecord.h"
+#include "MonTable.h"
+using namespace std;
+
+const char MATCH_FILE_MAGIC[4] = { 'R', 'S', 'M', 'B' };
+
+/* ******************************************************
+ * Purpose: Builds the header written at the start of a
+ *   binary match file
+ * ******************************************************
+ * Parameters:
+ *   monCount: number of enemy mons the records index
+ *   pid: PID of the run
+ * ******************************************************
+*/
+string matchFileHeaderBytes(int monCount, long long pid) {
+    MatchFileHeader header = MatchFileHeader();
+    memcpy(header.magic, MATCH_FILE_MAGIC, sizeof(header.magic));
+    header.version = MATCH_FILE_VERSION;
+    header.recordSize = sizeof(MatchRecord);
+    header.monCount = monCount;
+    header.pid = pid;
+    return string((const char*)&header, sizeof(header));
+}
+
+/* ******************************************************
+ * Purpose: Reads and checks a binary match file header
+ * ******************************************************
+ * Parameters:
+ *   matchFile: file opened in binary mode
+ *   header: Outputs the header
+ *   recordCount: Outputs the number of records after it
+ * ******************************************************
+*/
+bool readMatchFileHeader(ifstream &matchFile, MatchFileHeader &header, uint64_t &recordCount) {
+    matchFile.seekg(0, ios::end);
+    uint64_t fileSize = matchFile.tellg();
+    matchFile.seekg(0, ios::beg);
+    if (fileSize < sizeof(header) || !matchFile.read((char*)&header, sizeof(header))) {
+        return false;
+    }
+    if (memcmp(header.magic, MATCH_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != MATCH_FILE_VERSION || header.recordSize != sizeof(MatchRecord)) {
+        return false;
+    }
+    recordCount = (fileSize - sizeof(header)) / sizeof(MatchRecord);
+    return true;
+}
+
+/* ******************************************************
+ * Purpose: Finds how many advances of TID and SID data a
+ *   binary match file needs, one past its largest TID or
+ *   frame
+ * ******************************************************
+ * Parameters:
+ *   matchFilePath: binary match file
+ * ******************************************************
+*/
+int matchFileAdvances(string matchFilePath) {
+    ifstream matchFile(matchFilePath, ios::binary);
+    MatchFileHeader header = MatchFileHeader();
+    uint64_t recordCount = 0;
+    if (!readMatchFileHeader(matchFile, header, recordCount)) {
+        return 0;
+    }
+    const size_t CHUNK_RECORDS = 16384;
+    vector<MatchRecord> records = vector<MatchRecord>(CHUNK_RECORDS);
+    uint32_t maxAdvance = 0;
+    for (uint64_t recordIndex = 0; recordIndex < recordCount; recordIndex += CHUNK_RECORDS) {
+        size_t chunkRecords = recordCount - recordIndex < CHUNK_RECORDS ? recordCount - recordIndex : CHUNK_RECORDS;
+        matchFile.read((char*)records.data(), chunkRecords * sizeof(MatchRecord));
+        for (size_t chunkIndex = 0; chunkIndex < chunkRecords; chunkIndex++) {
+            maxAdvance = max(maxAdvance, max(records[chunkIndex].tid, records[chunkIndex].frame));
+        }
+    }
+    return recordCount > 0 ? maxAdvance + 1 : 0;
+}
+
+/* ******************************************************
+ * Purpose: Tags an existing binary match file with a PID
+ * ******************************************************
+ * Parameters:
+ *   matchFilePath: binary match file
+ *   pid: PID to write into the header
+ * ******************************************************
+*/
+bool setMatchFilePid(string matchFilePath, long long pid) {
+    fstream matchFile(matchFilePath, ios::in | ios::out | ios::binary);
+    MatchFileHeader header = MatchFileHeader();
+    if (!matchFile.read((char*)&header, sizeof(header))) {
+        return false;
+    }
+    header.pid = pid;
+    matchFile.seekp(0);
+    return (bool)matchFile.write((const char*)&header, sizeof(header));
+}
+
+/* ******************************************************
+ * Purpose: Finds the first record with a TID of at least
+ *   tid. Records are sorted by TID then frame.
+ * ******************************************************
+ * Parameters:
+ *   matchFile: binary match file
+ *   recordCount: records in the file
+ *   tid: TID to search for
+ * ******************************************************
+*/
+uint64_t lowerBoundTid(ifstream &matchFile, uint64_t recordCount, long long tid) {
+    uint64_t low = 0;
+    uint64_t high = recordCount;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        MatchRecord record = MatchRecord();
+        matchFile.seekg(sizeof(MatchFileHeader) + middle * sizeof(MatchRecord));
+        matchFile.read((char*)&record, sizeof(record));
+        if (record.tid < tid) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/* ******************************************************
+ * Purpose: Packs a matching mon into a match record
+ * ******************************************************
+ * Parameters:
+ *   tid: Player frame
+ *   frame: Enemy frame
+ *   record: matching mon and pokeball record
+ *   keysXored: player key ^ enemy key
+ * ******************************************************
+*/
+MatchRecord makeMatchRecord(int tid, int frame, const MonRecord &record, long long keysXored) {
+    MatchRecord matchRecord = {
+        (uint32_t)tid,                                  // uint32_t tid;
+        (uint32_t)frame,                                // uint32_t frame;
+        (uint16_t)record.monIndex,                      // uint16_t monIndex;
+        (uint8_t)record.pokeball,                       // uint8_t pokeball;
+        ((keysXored ^ record.data[0]) % 65536) == 39710 ? MATCH_FLAG_ACE : (uint8_t)0, // uint8_t flags;
+        (uint32_t)(keysXored ^ record.data[0]),         // uint32_t keyXorData0;
+        (uint32_t)(keysXored ^ record.data[3]),         // uint32_t keyXorData3;
+        (uint32_t)(keysXored ^ record.data[4]),         // uint32_t keyXorData4;
+        (uint32_t)(keysXored ^ record.data[10]),        // uint32_t keyXorData10;
+    };
+    return matchRecord;
+}
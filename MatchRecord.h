@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include "MonTable.h"
+using namespace std;
+
+struct MatchRecord {
+    uint32_t tid;
+    uint32_t frame;
+    uint16_t monIndex;
+    uint8_t pokeball;
+    uint8_t flags;
+    uint32_t keyXorData0;
+    uint32_t keyXorData3;
+    uint32_t keyXorData4;
+    uint32_t keyXorData10;
+};
+static_assert(sizeof(MatchRecord) == 28, "MatchRecord must stay 28 bytes");
+
+struct MatchFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t monCount;
+    int64_t pid;
+};
+static_assert(sizeof(MatchFileHeader) == 24, "MatchFileHeader must stay 24 bytes");
+
+const uint8_t MATCH_FLAG_ACE = 1;
+const uint32_t MATCH_FILE_VERSION = 1;
+
+string matchFileHeaderBytes(int monCount, long long pid);
+bool readMatchFileHeader(ifstream &matchFile, MatchFileHeader &header, uint64_t &recordCount);
+int matchFileAdvances(string matchFilePath);
+bool setMatchFilePid(string matchFilePath, long long pid);
+uint64_t lowerBoundTid(ifstream &matchFile, uint64_t recordCount, long long tid);
+MatchRecord makeMatchRecord(int tid, int frame, const MonRecord &record, long long keysXored);
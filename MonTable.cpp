@@ -0,0 +1,56 @@
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "MonTable.h"
+using namespace std;
+
+const long long POKEBALL_MASK = 0b10000111111111111111111111111111;
+
+/* ******************************************************
+ * Purpose: Compiles the parsed enemy data and data order
+ *   into one contiguous table with a 64 byte record per
+ *   mon and pokeball. Each record holds the data words
+ *   already in data order with the pokeball bits set and
+ *   the original checksum, so nothing downstream needs
+ *   the maps again.
+ * ******************************************************
+ * Parameters:
+ *   dataOrder: data order string for each PID % 24
+ *   dataOrderOrder: map of data order to word order
+ *   enemyList: vector of enemy mons
+ *   enemyDict: map of enemy mon to enemy data
+ * ******************************************************
+*/
+MonTable compileMonTable(const string dataOrder[], map<string, vector<int>> &dataOrderOrder, vector<string> &enemyList, map<string, vector<long long>> &enemyDict) {
+    MonTable monTable = MonTable();
+    monTable.monCount = enemyList.size();
+    monTable.records = vector<MonRecord>(monTable.monCount * 12);
+
+    for (int monIndex = 0; monIndex < monTable.monCount; monIndex++) {
+        vector<long long> &enemyMonData = enemyDict[enemyList[monIndex]];
+        vector<int> &usedDataOrder = dataOrderOrder[dataOrder[enemyMonData[0] % 24]];
+        long long data[12] = {};
+        for (int dataOrderIndex = 0; dataOrderIndex < 12; dataOrderIndex++) {
+            data[dataOrderIndex] = enemyMonData[usedDataOrder[dataOrderIndex]];
+        }
+
+        for (int pokeballIndex = 1; pokeballIndex < 13; pokeballIndex++) {
+            data[9] = (data[9] & POKEBALL_MASK) + ((long long)pokeballIndex << 27);
+            MonRecord &record = monTable.records[monIndex * 12 + pokeballIndex - 1];
+            long long checksum = 0;
+            for (int dataIndex = 0; dataIndex < 12; dataIndex++) {
+                record.data[dataIndex] = (uint32_t)data[dataIndex];
+                checksum += (data[dataIndex] % 65536) + (data[dataIndex] / 65536);
+            }
+            record.checksum = (uint16_t)checksum;
+            record.pokeball = pokeballIndex;
+            record.monIndex = monIndex;
+        }
+    }
+    return monTable;
+}
+
+const MonRecord &MonTable::record(int monIndex, int pokeball) const {
+    return records[monIndex * 12 + pokeball - 1];
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+struct alignas(64) MonRecord {
+    uint32_t data[12];
+    uint16_t checksum;
+    uint16_t pokeball;
+    int32_t monIndex;
+};
+
+struct MonTable {
+    int monCount;
+    vector<MonRecord> records;
+
+    const MonRecord &record(int monIndex, int pokeball) const;
+};
+
+MonTable compileMonTable(const string dataOrder[], map<string, vector<int>> &dataOrderOrder, vector<string> &enemyList, map<string, vector<long long>> &enemyDict);
@@ -0,0 +1,159 @@
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "NumaTopology.h"
+#ifdef __linux__
+#include <sched.h>
+#endif
+using namespace std;
+
+/* ******************************************************
+ * Purpose: Parses a sysfs cpu list such as 0-3,8-11
+ * ******************************************************
+ * Parameters:
+ *   cpuList: comma separated CPUs and CPU ranges
+ * ******************************************************
+*/
+vector<int> parseCpuList(string cpuList) {
+    vector<int> cpus = vector<int>();
+    stringstream listStream(cpuList);
+    string range = "";
+    while (getline(listStream, range, ',')) {
+        if (range.find_first_of("0123456789") == string::npos) {
+            continue;
+        }
+        size_t dashIndex = range.find('-');
+        int first = stoi(range.substr(0, dashIndex));
+        int last = dashIndex == string::npos ? first : stoi(range.substr(dashIndex + 1));
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+/* ******************************************************
+ * Purpose: Reads the NUMA nodes and the CPUs of each
+ *   that this process may run on. Without sysfs it is
+ *   one node holding every CPU.
+ * ******************************************************
+*/
+NumaTopology readNumaTopology() {
+    NumaTopology topology = NumaTopology();
+    int cpuCount = thread::hardware_concurrency() > 0 ? thread::hardware_concurrency() : 1;
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool haveAllowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    for (int node = 0; ; node++) {
+        ifstream cpuListFile("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+        string cpuList = "";
+        if (!cpuListFile || !getline(cpuListFile, cpuList)) {
+            break;
+        }
+        vector<int> nodeCpus = vector<int>();
+        for (int cpu : parseCpuList(cpuList)) {
+            if (!haveAllowed || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) {
+                nodeCpus.push_back(cpu);
+            }
+        }
+        if (!nodeCpus.empty()) {
+            topology.nodeCpus.push_back(nodeCpus);
+        }
+    }
+#endif
+    if (topology.nodeCpus.empty()) {
+        topology.nodeCpus.push_back(vector<int>());
+        for (int cpu = 0; cpu < cpuCount; cpu++) {
+            topology.nodeCpus[0].push_back(cpu);
+        }
+    }
+    for (size_t node = 0; node < topology.nodeCpus.size(); node++) {
+        for (int cpu : topology.nodeCpus[node]) {
+            if (cpu >= (int)topology.cpuNodes.size()) {
+                topology.cpuNodes.resize(cpu + 1, -1);
+            }
+            topology.cpuNodes[cpu] = node;
+        }
+    }
+    return topology;
+}
+
+/* ******************************************************
+ * Purpose: Picks a CPU for each worker, dealing workers
+ *   round robin across the nodes so every node's memory
+ *   and its copy of the tables serve the same share
+ * ******************************************************
+ * Parameters:
+ *   topology: NUMA nodes and their CPUs
+ *   threads: number of workers
+ * ******************************************************
+*/
+vector<int> spreadWorkerCpus(const NumaTopology &topology, int threads) {
+    vector<int> workerCpus = vector<int>();
+    for (int worker = 0; worker < threads; worker++) {
+        const vector<int> &nodeCpus = topology.nodeCpus[worker % topology.nodeCpus.size()];
+        workerCpus.push_back(nodeCpus[(worker / topology.nodeCpus.size()) % nodeCpus.size()]);
+    }
+    return workerCpus;
+}
+
+/* ******************************************************
+ * Purpose: Pins the calling thread to one CPU
+ * ******************************************************
+ * Parameters:
+ *   cpu: CPU to run on
+ * ******************************************************
+ * Returns: false where pinning isn't supported
+ * ******************************************************
+*/
+bool pinThreadToCpu(int cpu) {
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+#else
+    return false;
+#endif
+}
+
+/* ******************************************************
+ * Purpose: Finds the node of the CPU the calling thread
+ *   is running on, 0 when unknown
+ * ******************************************************
+ * Parameters:
+ *   topology: NUMA nodes and their CPUs
+ * ******************************************************
+*/
+int currentNumaNode(const NumaTopology &topology) {
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu >= 0 && cpu < (int)topology.cpuNodes.size() && topology.cpuNodes[cpu] >= 0) {
+        return topology.cpuNodes[cpu];
+    }
+#endif
+    return 0;
+}
+
+/* ******************************************************
+ * Purpose: Runs work on a thread pinned to a node. Pages
+ *   are placed on the node of the thread that first
+ *   writes them, so tables filled here live on that node.
+ * ******************************************************
+ * Parameters:
+ *   topology: NUMA nodes and their CPUs
+ *   node: node to run on
+ *   work: function to run
+ * ******************************************************
+*/
+void runOnNumaNode(const NumaTopology &topology, int node, function<void()> work) {
+    thread nodeThread([&topology, node, &work]() {
+        pinThreadToCpu(topology.nodeCpus[node][0]);
+        work();
+        });
+    nodeThread.join();
+}
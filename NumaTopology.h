@@ -0,0 +1,15 @@
+#pragma once
+#include <functional>
+#include <vector>
+using namespace std;
+
+struct NumaTopology {
+    vector<vector<int>> nodeCpus;
+    vector<int> cpuNodes;
+};
+
+NumaTopology readNumaTopology();
+vector<int> spreadWorkerCpus(const NumaTopology &topology, int threads);
+bool pinThreadToCpu(int cpu);
+int currentNumaNode(const NumaTopology &topology);
+void runOnNumaNode(const NumaTopology &topology, int node, function<void()> work);
@@ -0,0 +1,78 @@
+#include <cstdint>
+#include "OtidGenerator.h"
+#include "OtidTable.h"
+#include "ThreadPool.h"
+using namespace std;
+
+const uint32_t LCRNG_MULTIPLIER = 0x41C64E6D;
+const uint32_t LCRNG_INCREMENT = 0x6073;
+const int OTID_CHUNK_ADVANCES = 65536;
+
+/* ******************************************************
+ * Purpose: Advances the Gen 3 LCRNG by one call
+ * ******************************************************
+ * Parameters:
+ *   seed: current RNG state
+ * ******************************************************
+*/
+uint32_t lcrngNext(uint32_t seed) {
+    return seed * LCRNG_MULTIPLIER + LCRNG_INCREMENT;
+}
+
+/* ******************************************************
+ * Purpose: Advances the Gen 3 LCRNG by any number of
+ *   calls in O(log n) by squaring the affine step
+ * ******************************************************
+ * Parameters:
+ *   seed: current RNG state
+ *   advances: number of calls to skip
+ * ******************************************************
+*/
+uint32_t lcrngJump(uint32_t seed, long long advances) {
+    uint32_t multiplier = LCRNG_MULTIPLIER;
+    uint32_t increment = LCRNG_INCREMENT;
+    while (advances > 0) {
+        if (advances & 1) {
+            seed = seed * multiplier + increment;
+        }
+        increment = increment * (multiplier + 1);
+        multiplier = multiplier * multiplier;
+        advances >>= 1;
+    }
+    return seed;
+}
+
+/* ******************************************************
+ * Purpose: Builds the TID and SID of every advance from
+ *   the LCRNG instead of OTIDs.csv. The SID of advance n
+ *   is the high half of call n + 1 and the TID is the
+ *   high half of call n + 2, so the TID of one advance is
+ *   the SID of the next. Chunks jump ahead to their first
+ *   advance and fill in parallel.
+ * ******************************************************
+ * Parameters:
+ *   seed: RNG state before advance 0
+ *   advances: number of advances to build
+ *   threads: number of threads to fill with
+ * ******************************************************
+*/
+OtidTable generateOtidTable(uint32_t seed, int advances, int threads) {
+    OtidTable otidTable = OtidTable();
+    otidTable.tids.resize(advances);
+    otidTable.sids.resize(advances);
+
+    ThreadPool pool(threads);
+    for (int chunkStart = 0; chunkStart < advances; chunkStart += OTID_CHUNK_ADVANCES) {
+        int chunkEnd = chunkStart + OTID_CHUNK_ADVANCES < advances ? chunkStart + OTID_CHUNK_ADVANCES : advances;
+        pool.enqueue([seed, chunkStart, chunkEnd, &otidTable]() {
+            uint32_t state = lcrngJump(seed, chunkStart + 1);
+            for (int advance = chunkStart; advance < chunkEnd; advance++) {
+                otidTable.sids[advance] = state >> 16;
+                state = lcrngNext(state);
+                otidTable.tids[advance] = state >> 16;
+            }
+            });
+    }
+    pool.stopAndWait();
+    return otidTable;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+#include "OtidTable.h"
+using namespace std;
+
+// The seed OTIDs.csv was generated from, one call before advance 0
+const uint32_t DEFAULT_OTID_SEED = 0x5A0;
+const int MAX_GENERATED_ADVANCE = 100000000;
+
+uint32_t lcrngNext(uint32_t seed);
+uint32_t lcrngJump(uint32_t seed, long long advances);
+OtidTable generateOtidTable(uint32_t seed, int advances, int threads);
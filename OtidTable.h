@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+struct OtidTable {
+    vector<uint16_t> tids;
+    vector<uint16_t> sids;
+};
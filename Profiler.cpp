@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Profiler.h"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+using namespace std;
+using namespace chrono;
+
+const char* PROFILE_COUNTER_NAMES[PROFILE_COUNTER_COUNT] = { "cycles", "instructions", "cacheMisses", "branchMisses" };
+
+struct ProfileEvent {
+    const char* name;
+    uint64_t startNanos;
+    uint64_t durationNanos;
+    ProfileCounters counters;
+};
+
+// Events of one thread, only that thread appends to it
+struct ThreadProfile {
+    int threadIndex;
+    int counterFd = -1;
+    int counterCount = 0;
+    vector<int> counterFds;
+    vector<ProfileEvent> events;
+};
+
+// Closes a thread's counters when the thread exits. Its last
+// scope has read them by then, and its events outlive it.
+struct ThreadCounterCloser {
+    ThreadProfile* profile = nullptr;
+    ~ThreadCounterCloser();
+};
+
+atomic<bool> profilerOn(false);
+atomic<bool> countersAvailable(true);
+string counterStatus = "";
+steady_clock::time_point profileStart;
+mutex profilesMutex;
+vector<unique_ptr<ThreadProfile>> threadProfiles;
+thread_local ThreadProfile* localProfile = nullptr;
+thread_local ThreadCounterCloser localCounterCloser;
+
+/* ******************************************************
+ * Purpose: Opens this thread's hardware counter group:
+ *   cycles, instructions, cache misses and branch misses.
+ *   Without perf_event_open, or when the kernel refuses,
+ *   only timings are recorded.
+ * ******************************************************
+ * Parameters:
+ *   profile: calling thread's profile
+ * ******************************************************
+*/
+void openThreadCounters(ThreadProfile &profile) {
+#ifdef __linux__
+    const uint64_t CONFIGS[PROFILE_COUNTER_COUNT] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+    for (int counterIndex = 0; counterIndex < PROFILE_COUNTER_COUNT; counterIndex++) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = CONFIGS[counterIndex];
+        attr.disabled = counterIndex == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, counterIndex == 0 ? -1 : profile.counterFd, 0);
+        if (fd < 0) {
+            if (counterIndex == 0) {
+                lock_guard<mutex> lock(profilesMutex);
+                if (countersAvailable.exchange(false)) {
+                    counterStatus = string("hardware counters unavailable (") + strerror(errno) + "), recording timings only";
+                }
+                return;
+            }
+            // Counters after the first failure stay unread
+            break;
+        }
+        if (counterIndex == 0) {
+            profile.counterFd = fd;
+            localCounterCloser.profile = &profile;
+        }
+        profile.counterFds.push_back(fd);
+        profile.counterCount++;
+    }
+    ioctl(profile.counterFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(profile.counterFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+    lock_guard<mutex> lock(profilesMutex);
+    if (countersAvailable.exchange(false)) {
+        counterStatus = "hardware counters need Linux perf_event_open, recording timings only";
+    }
+#endif
+}
+
+ThreadCounterCloser::~ThreadCounterCloser() {
+#ifdef __linux__
+    if (profile == nullptr) {
+        return;
+    }
+    for (int fd : profile->counterFds) {
+        close(fd);
+    }
+    profile->counterFds.clear();
+    profile->counterFd = -1;
+#endif
+}
+
+/* ******************************************************
+ * Purpose: Finds or creates the calling thread's profile
+ * ******************************************************
+*/
+ThreadProfile &threadProfile() {
+    if (localProfile == nullptr) {
+        {
+            lock_guard<mutex> lock(profilesMutex);
+            threadProfiles.emplace_back(new ThreadProfile());
+            localProfile = threadProfiles.back().get();
+            localProfile->threadIndex = threadProfiles.size() - 1;
+        }
+        if (countersAvailable) {
+            openThreadCounters(*localProfile);
+        }
+    }
+    return *localProfile;
+}
+
+/* ******************************************************
+ * Purpose: Reads the calling thread's counters, zeros if
+ *   they are not open
+ * ******************************************************
+ * Parameters:
+ *   profile: calling thread's profile
+ *   counters: Outputs counter values
+ * ******************************************************
+*/
+void readThreadCounters(const ThreadProfile &profile, ProfileCounters &counters) {
+    memset(&counters, 0, sizeof(counters));
+#ifdef __linux__
+    if (profile.counterFd < 0) {
+        return;
+    }
+    uint64_t groupValues[1 + PROFILE_COUNTER_COUNT] = {};
+    if (read(profile.counterFd, groupValues, sizeof(groupValues)) > 0) {
+        for (uint64_t counterIndex = 0; counterIndex < groupValues[0] && counterIndex < PROFILE_COUNTER_COUNT; counterIndex++) {
+            counters.values[counterIndex] = groupValues[1 + counterIndex];
+        }
+    }
+#endif
+}
+
+/* ******************************************************
+ * Purpose: Turns on profiling for the rest of the run
+ * ******************************************************
+*/
+void enableProfiler() {
+    profileStart = steady_clock::now();
+    profilerOn = true;
+    threadProfile();
+}
+
+bool profilerEnabled() {
+    return profilerOn;
+}
+
+bool profilerHasCounters() {
+    return countersAvailable;
+}
+
+string profilerCounterStatus() {
+    lock_guard<mutex> lock(profilesMutex);
+    return counterStatus.empty() ? "hardware counters available" : counterStatus;
+}
+
+ProfileScope::ProfileScope(const char* name) : name_(name), active_(profilerOn.load(memory_order_relaxed)), startNanos_(0) {
+    if (!active_) {
+        return;
+    }
+    ThreadProfile &profile = threadProfile();
+    readThreadCounters(profile, startCounters_);
+    startNanos_ = duration_cast<nanoseconds>(steady_clock::now() - profileStart).count();
+}
+
+ProfileScope::~ProfileScope() {
+    if (!active_) {
+        return;
+    }
+    uint64_t endNanos = duration_cast<nanoseconds>(steady_clock::now() - profileStart).count();
+    ThreadProfile &profile = threadProfile();
+    ProfileEvent event = { name_, startNanos_, endNanos - startNanos_, ProfileCounters() };
+    readThreadCounters(profile, event.counters);
+    for (int counterIndex = 0; counterIndex < PROFILE_COUNTER_COUNT; counterIndex++) {
+        event.counters.values[counterIndex] -= startCounters_.values[counterIndex];
+    }
+    profile.events.push_back(event);
+}
+
+/* ******************************************************
+ * Purpose: Writes every recorded scope as a Chrome trace
+ *   (chrome://tracing, Perfetto or speedscope) and a per
+ *   scope report of time and counters. Call once every
+ *   profiled thread has finished.
+ * ******************************************************
+ * Parameters:
+ *   tracePath: Chrome trace JSON file
+ *   reportPath: text report file
+ * ******************************************************
+*/
+void writeProfile(string tracePath, string reportPath) {
+    lock_guard<mutex> lock(profilesMutex);
+    int counterCount = 0;
+    for (const unique_ptr<ThreadProfile> &profile : threadProfiles) {
+        counterCount = max(counterCount, profile->counterCount);
+    }
+
+    ofstream traceFile(tracePath, ios::out | ios::trunc);
+    traceFile << fixed << setprecision(3) << "{\"traceEvents\":[\n";
+    bool firstEvent = true;
+    map<string, pair<uint64_t, uint64_t>> scopeTimes = map<string, pair<uint64_t, uint64_t>>();
+    map<string, ProfileCounters> scopeCounters = map<string, ProfileCounters>();
+    for (const unique_ptr<ThreadProfile> &profile : threadProfiles) {
+        for (const ProfileEvent &event : profile->events) {
+            traceFile << (firstEvent ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << profile->threadIndex
+                << ",\"ts\":" << event.startNanos / 1000.0 << ",\"dur\":" << event.durationNanos / 1000.0 << ",\"args\":{";
+            for (int counterIndex = 0; counterIndex < profile->counterCount; counterIndex++) {
+                traceFile << (counterIndex > 0 ? "," : "") << "\"" << PROFILE_COUNTER_NAMES[counterIndex] << "\":" << event.counters.values[counterIndex];
+            }
+            traceFile << "}}";
+            firstEvent = false;
+
+            pair<uint64_t, uint64_t> &times = scopeTimes[event.name];
+            times.first++;
+            times.second += event.durationNanos;
+            ProfileCounters &counters = scopeCounters.insert(pair<string, ProfileCounters>(event.name, ProfileCounters())).first->second;
+            for (int counterIndex = 0; counterIndex < PROFILE_COUNTER_COUNT; counterIndex++) {
+                counters.values[counterIndex] += event.counters.values[counterIndex];
+            }
+        }
+    }
+    traceFile << "\n]}\n";
+
+    ofstream reportFile(reportPath, ios::out | ios::trunc);
+    reportFile << "Profile: " << (counterStatus.empty() ? "hardware counters available" : counterStatus) << "\n\n";
+    reportFile << left << setw(16) << "scope" << right << setw(10) << "calls" << setw(14) << "total ms" << setw(12) << "mean us";
+    for (int counterIndex = 0; counterIndex < counterCount; counterIndex++) {
+        reportFile << setw(16) << PROFILE_COUNTER_NAMES[counterIndex];
+    }
+    reportFile << (counterCount >= 2 ? "         IPC" : "") << "\n";
+    for (const pair<const string, pair<uint64_t, uint64_t>> &scope : scopeTimes) {
+        const ProfileCounters &counters = scopeCounters[scope.first];
+        reportFile << fixed << setprecision(3) << left << setw(16) << scope.first << right << setw(10) << scope.second.first
+            << setw(14) << scope.second.second / 1e6 << setw(12) << scope.second.second / 1e3 / scope.second.first;
+        for (int counterIndex = 0; counterIndex < counterCount; counterIndex++) {
+            reportFile << setw(16) << counters.values[counterIndex];
+        }
+        if (counterCount >= 2) {
+            reportFile << setw(12) << setprecision(2) << (counters.values[0] > 0 ? (double)counters.values[1] / counters.values[0] : 0.0);
+        }
+        reportFile << "\n";
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <string>
+using namespace std;
+
+const int PROFILE_COUNTER_COUNT = 4;
+
+struct ProfileCounters {
+    uint64_t values[PROFILE_COUNTER_COUNT];
+};
+
+void enableProfiler();
+bool profilerEnabled();
+bool profilerHasCounters();
+string profilerCounterStatus();
+void writeProfile(string tracePath, string reportPath);
+
+// Times the enclosing scope, with hardware counters where
+// available, when --profile is on. Costs one branch when off.
+class ProfileScope {
+public:
+ProfileScope(const char* name);
+~ProfileScope();
+ProfileScope(const ProfileScope &) = delete;
+ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+const char* name_;
+bool active_;
+uint64_t startNanos_;
+ProfileCounters startCounters_;
+};
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ChecksumEngine.h"
+#include "MatchExport.h"
+#include "MatchFilter.h"
+#include "MatchRecord.h"
+#include "QueryServer.h"
+#include "RunContext.h"
+#include "SweepTile.h"
+#include "ThreadPool.h"
+using namespace std;
+using namespace chrono;
+
+/* ******************************************************
+ * Purpose: Parses one line holding a flat JSON object.
+ *   Values are kept as their raw JSON text so strings,
+ *   numbers and arrays of numbers can be read as needed.
+ * ******************************************************
+ * Parameters:
+ *   line: JSON object text
+ *   fields: Outputs raw value text by key
+ * ******************************************************
+*/
+bool parseJsonObject(string line, map<string, string> &fields) {
+    size_t position = 0;
+    auto skipSpace = [&line, &position]() {
+        while (position < line.length() && isspace((unsigned char)line[position])) {
+            position++;
+        }
+    };
+    // Index one past the closing quote of the string starting at start
+    auto stringEnd = [&line](size_t start) {
+        size_t end = start + 1;
+        while (end < line.length() && line[end] != '"') {
+            end += line[end] == '\\' ? 2 : 1;
+        }
+        return end < line.length() ? end + 1 : string::npos;
+    };
+
+    skipSpace();
+    if (position >= line.length() || line[position] != '{') {
+        return false;
+    }
+    position++;
+    skipSpace();
+    if (position < line.length() && line[position] == '}') {
+        return true;
+    }
+    while (position < line.length()) {
+        skipSpace();
+        if (position >= line.length() || line[position] != '"') {
+            return false;
+        }
+        size_t keyEnd = stringEnd(position);
+        if (keyEnd == string::npos) {
+            return false;
+        }
+        string key = line.substr(position + 1, keyEnd - position - 2);
+        position = keyEnd;
+        skipSpace();
+        if (position >= line.length() || line[position] != ':') {
+            return false;
+        }
+        position++;
+        skipSpace();
+
+        size_t valueStart = position;
+        if (position < line.length() && line[position] == '"') {
+            position = stringEnd(position);
+        } else if (position < line.length() && line[position] == '[') {
+            position = line.find(']', position);
+            position = position == string::npos ? position : position + 1;
+        } else {
+            while (position < line.length() && line[position] != ',' && line[position] != '}' && !isspace((unsigned char)line[position])) {
+                position++;
+            }
+        }
+        if (position == string::npos || position == valueStart) {
+            return false;
+        }
+        fields[key] = line.substr(valueStart, position - valueStart);
+        skipSpace();
+        if (position < line.length() && line[position] == ',') {
+            position++;
+        } else if (position < line.length() && line[position] == '}') {
+            return true;
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
+
+/* ******************************************************
+ * Purpose: Reads a raw JSON string value, undoing \" and
+ *   \\ escapes. Other values are returned as they are.
+ * ******************************************************
+ * Parameters:
+ *   raw: raw JSON value text
+ * ******************************************************
+*/
+string jsonStringValue(string raw) {
+    if (raw.length() < 2 || raw[0] != '"') {
+        return raw;
+    }
+    string value = "";
+    for (size_t charIndex = 1; charIndex + 1 < raw.length(); charIndex++) {
+        if (raw[charIndex] == '\\' && charIndex + 2 < raw.length()) {
+            charIndex++;
+        }
+        value += raw[charIndex];
+    }
+    return value;
+}
+
+/* ******************************************************
+ * Purpose: Reads an inclusive range from a raw JSON value,
+ *   either [first, last] or a single number
+ * ******************************************************
+ * Parameters:
+ *   raw: raw JSON value text
+ *   rangeStart: Outputs the first value
+ *   rangeEnd: Outputs the last value
+ * ******************************************************
+*/
+void jsonRangeValue(string raw, int &rangeStart, int &rangeEnd) {
+    if (raw.empty() || raw[0] != '[') {
+        rangeStart = stoi(jsonStringValue(raw), 0, 0);
+        rangeEnd = rangeStart;
+        return;
+    }
+    size_t commaIndex = raw.find(',');
+    if (commaIndex == string::npos) {
+        throw invalid_argument("ranges are [first, last]");
+    }
+    rangeStart = stoi(raw.substr(1, commaIndex - 1));
+    rangeEnd = stoi(raw.substr(commaIndex + 1, raw.length() - commaIndex - 2));
+}
+
+/* ******************************************************
+ * Purpose: Answers one query, streaming a JSON line per
+ *   match and then a done line. Tiles are calculated in
+ *   waves across the pool and written in order, so a
+ *   limit stops the query after the wave that reaches it.
+ * ******************************************************
+ * Parameters:
+ *   context: shared tables for the server
+ *   pool: worker threads
+ *   fields: parsed query
+ *   out: stream to answer on
+ * ******************************************************
+*/
+void answerQuery(const RunContext &context, ThreadPool &pool, map<string, string> &fields, ostream &out) {
+    steady_clock::time_point start = steady_clock::now();
+    string id = fields.count("id") ? fields["id"] : "null";
+
+    int tidStart = 0;
+    int tidEnd = 0;
+    int frameStart = 0;
+    int frameEnd = context.frames - 1;
+    long long limit = -1;
+    MatchFilter filter = MatchFilter();
+    try {
+        if (!fields.count("tids") && !fields.count("tid")) {
+            throw invalid_argument("tid or tids is required");
+        }
+        jsonRangeValue(fields.count("tids") ? fields["tids"] : fields["tid"], tidStart, tidEnd);
+        if (fields.count("frames")) {
+            jsonRangeValue(fields["frames"], frameStart, frameEnd);
+        }
+        if (fields.count("limit")) {
+            limit = stoll(fields["limit"]);
+        }
+        filter = parseMatchFilter(fields.count("filter") ? jsonStringValue(fields["filter"]) : "");
+        if (tidStart < 0 || tidEnd < tidStart || tidEnd >= (int)context.otidTable.tids.size()) {
+            throw invalid_argument("tids must be within 0 and " + to_string(context.otidTable.tids.size() - 1));
+        }
+        if (frameStart < 0 || frameEnd < frameStart || frameEnd >= context.frames) {
+            throw invalid_argument("frames must be within 0 and " + to_string(context.frames - 1));
+        }
+    }
+    catch (const exception &error) {
+        string message = "";
+        appendJsonString(message, error.what());
+        out << "{\"id\":" << id << ",\"error\":" << message << "}" << endl;
+        return;
+    }
+
+    vector<SweepTile> tiles = buildSweepTiles(tidStart, tidEnd, frameStart, frameEnd + 1, DEFAULT_TILE_FRAMES);
+    size_t waveTiles = pool.size() * 4;
+    long long matchCount = 0;
+    bool truncated = false;
+    string lines = "";
+    for (size_t waveStart = 0; waveStart < tiles.size() && !truncated; waveStart += waveTiles) {
+        size_t waveEnd = min(tiles.size(), waveStart + waveTiles);
+        vector<vector<MatchRecord>> waveRecords = vector<vector<MatchRecord>>(waveEnd - waveStart);
+        for (size_t tileIndex = waveStart; tileIndex < waveEnd; tileIndex++) {
+            SweepTile tile = tiles[tileIndex];
+            vector<MatchRecord> &tileRecords = waveRecords[tileIndex - waveStart];
+            pool.enqueue([&context, &filter, tile, &tileRecords]() {
+                findTileRecords(context, filter, tile, tileRecords);
+                });
+        }
+        pool.wait();
+
+        for (const vector<MatchRecord> &tileRecords : waveRecords) {
+            for (const MatchRecord &record : tileRecords) {
+                if (limit >= 0 && matchCount >= limit) {
+                    truncated = true;
+                    break;
+                }
+                formatMatchJson(record, context.otidTable, context.enemyList, lines);
+                matchCount++;
+            }
+        }
+        out << lines;
+        lines.clear();
+    }
+
+    long long micros = duration_cast<microseconds>(steady_clock::now() - start).count();
+    out << "{\"id\":" << id << ",\"done\":true,\"matches\":" << matchCount << ",\"truncated\":" << (truncated ? "true" : "false") << ",\"micros\":" << micros << "}" << endl;
+}
+
+/* ******************************************************
+ * Purpose: Serves queries on line delimited JSON until
+ *   end of input or {"cmd":"quit"}. Every table is loaded
+ *   once before the first query. A query looks like
+ *   {"id":1,"tids":[3575,3576],"frames":[0,3999],
+ *    "filter":"ace","limit":100}
+ * ******************************************************
+ * Parameters:
+ *   context: shared tables for the server
+ *   threads: number of worker threads
+ *   in: stream of queries
+ *   out: stream of answers
+ * ******************************************************
+*/
+int runQueryServer(const RunContext &context, int threads, istream &in, ostream &out) {
+    ThreadPool pool(threads);
+    out << "{\"ready\":true,\"tids\":[0," << context.otidTable.tids.size() - 1 << "],\"frames\":[0," << context.frames - 1 << "],\"mons\":" << context.monTable.monCount << "}" << endl;
+
+    string queryLine = "";
+    while (getline(in, queryLine)) {
+        if (queryLine.find_first_not_of(" \t\r") == string::npos) {
+            continue;
+        }
+        map<string, string> fields = map<string, string>();
+        if (!parseJsonObject(queryLine, fields)) {
+            out << "{\"id\":null,\"error\":\"query is not a JSON object\"}" << endl;
+            continue;
+        }
+        if (fields.count("cmd") && jsonStringValue(fields["cmd"]) == "quit") {
+            break;
+        }
+        answerQuery(context, pool, fields, out);
+    }
+    pool.stopAndWait();
+    return 0;
+}
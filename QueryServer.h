@@ -0,0 +1,9 @@
+#pragma once
+#include <iostream>
+#include <map>
+#include <string>
+#include "RunContext.h"
+using namespace std;
+
+bool parseJsonObject(string line, map<string, string> &fields);
+int runQueryServer(const RunContext &context, int threads, istream &in, ostream &out);
@@ -0,0 +1,266 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "RSChecksumCalculator.h"
+using namespace std;
+using namespace chrono;
+
+const long long BENCHMARK_PID = 1321080;
+const int BENCHMARK_TID = 3570;
+const int BENCHMARK_MATCH_FRAMES = 1000;
+const int BENCHMARK_EXPORT_TIDS = 20;
+const int DEFAULT_BENCHMARK_REPEATS = 5;
+const double DEFAULT_BENCHMARK_TOLERANCE = 0.25;
+const string DEFAULT_BENCHMARK_BASELINE = "./benchmarkBaseline.json";
+const size_t MAX_BENCHMARK_BUFFERED_OUTPUT = 64 * 1024 * 1024;
+
+struct BenchmarkResult {
+    string name;
+    string unit;
+    uint64_t units;
+    double seconds;
+};
+
+// Every benchmark folds its results in here so the work can't be optimised away
+volatile uint64_t benchmarkSink = 0;
+
+/* ******************************************************
+ * Purpose: Times a workload and keeps its fastest run
+ * ******************************************************
+ * Parameters:
+ *   name: benchmark name, the key in the baseline
+ *   unit: what one unit of work is, such as pair or row
+ *   repeats: number of timed runs
+ *   workload: runs the work once, returns units done
+ * ******************************************************
+*/
+BenchmarkResult runBenchmark(string name, string unit, int repeats, function<uint64_t()> workload) {
+    BenchmarkResult result = { name, unit, 0, 0 };
+    for (int repeat = 0; repeat < repeats; repeat++) {
+        steady_clock::time_point start = steady_clock::now();
+        uint64_t units = workload();
+        double seconds = duration<double>(steady_clock::now() - start).count();
+        if (repeat == 0 || seconds < result.seconds) {
+            result.units = units;
+            result.seconds = seconds;
+        }
+    }
+    return result;
+}
+
+/* ******************************************************
+ * Purpose: Reads a baseline of nanoseconds per unit
+ * ******************************************************
+ * Parameters:
+ *   baselinePath: JSON object of benchmark name to ns
+ *   baseline: Outputs ns per unit by benchmark name
+ * ******************************************************
+*/
+bool readBenchmarkBaseline(string baselinePath, map<string, double> &baseline) {
+    ifstream baselineFile(baselinePath);
+    if (!baselineFile) {
+        return false;
+    }
+    stringstream contents;
+    contents << baselineFile.rdbuf();
+    map<string, string> fields = map<string, string>();
+    if (!parseJsonObject(contents.str(), fields)) {
+        return false;
+    }
+    for (const pair<const string, string> &field : fields) {
+        baseline[field.first] = stod(field.second);
+    }
+    return true;
+}
+
+/* ******************************************************
+ * Purpose: Writes the results as the new baseline
+ * ******************************************************
+ * Parameters:
+ *   baselinePath: JSON file to write
+ *   results: benchmark results
+ * ******************************************************
+*/
+void writeBenchmarkBaseline(string baselinePath, const vector<BenchmarkResult> &results) {
+    ofstream baselineFile(baselinePath, ios::out | ios::trunc);
+    baselineFile << fixed << setprecision(3) << "{\n";
+    for (size_t resultIndex = 0; resultIndex < results.size(); resultIndex++) {
+        const BenchmarkResult &result = results[resultIndex];
+        baselineFile << "  \"" << result.name << "\": " << result.seconds * 1e9 / result.units << (resultIndex + 1 < results.size() ? ",\n" : "\n");
+    }
+    baselineFile << "}\n";
+}
+
+/* ******************************************************
+ * Purpose: Runs fixed workloads on the bundled data files
+ *   and compares ns per unit against a stored baseline.
+ *   Run from the directory with OTIDs.csv,
+ *   enemyDataList.csv and dataOrder.csv.
+ *   RSChecksumBenchmark [--baseline=path]
+ *     [--write-baseline] [--tolerance=0.25] [--repeat=5]
+ *   Exits 1 when a benchmark is slower than its baseline
+ *   by more than the tolerance.
+ * ******************************************************
+ * Parameters:
+ *   argc: Number of arguments
+ *   argv: Char* array of arguments
+ * ******************************************************
+*/
+int main(int argc, char* argv[]) {
+    map<string, string> options = parseOptions(argc, argv);
+    string baselinePath = options.count("baseline") ? options["baseline"] : DEFAULT_BENCHMARK_BASELINE;
+    double tolerance = options.count("tolerance") ? stod(options["tolerance"]) : DEFAULT_BENCHMARK_TOLERANCE;
+    int repeats = options.count("repeat") ? max(1, stoi(options["repeat"])) : DEFAULT_BENCHMARK_REPEATS;
+
+    // Canonical workload: the bundled OTIDs and enemy mons, every frame of OTIDs.csv
+    OtidTable otidTable = otidFileToTable("OTIDs.csv");
+    vector<string> enemyList = {};
+    map<string, vector<long long>> enemyDict = dataFileToMap("enemyDataList.csv", enemyList);
+    if (otidTable.tids.size() <= BENCHMARK_TID + BENCHMARK_EXPORT_TIDS || enemyList.empty()) {
+        cout << "Run the benchmark from the directory with OTIDs.csv and enemyDataList.csv." << endl;
+        return 1;
+    }
+    int frames = otidTable.tids.size();
+    string dataOrder[24] = {
+        "GAEM", "GAME", "GEAM", "GEMA", "GMAE", "GMEA",
+        "AGEM", "AGME", "AEGM", "AEMG", "AMGE", "AMEG",
+        "EGAM", "EGMA", "EAGM", "EAMG", "EMGA", "EMAG",
+        "MGAE", "MGEA", "MAGE", "MAEG", "MEGA", "MEAG"
+    };
+    map<string, vector<int>> dataOrderOrder = dataOrderToMap("dataOrder.csv");
+    shared_ptr<const RunContext> context = make_shared<const RunContext>(BENCHMARK_PID, frames, MatchFilter(), detectChecksumKernel(), dataOrder, dataOrderOrder, enemyList, enemyDict, otidTable);
+    long long playerKey = BENCHMARK_PID ^ (((long long)otidTable.sids[BENCHMARK_TID] << 16) | otidTable.tids[BENCHMARK_TID]);
+    int monCount = context->monTable.monCount;
+
+    vector<string> hexStrings = vector<string>();
+    {
+        ifstream enemyDataFile("enemyDataList.csv");
+        string enemyDataRawLine = "";
+        while (getline(enemyDataFile, enemyDataRawLine)) {
+            string enemyData = enemyDataRawLine.substr(enemyDataRawLine.find(",") + 1);
+            for (size_t pieceStart = 0; pieceStart + 8 <= enemyData.length(); pieceStart += 8) {
+                hexStrings.push_back(enemyData.substr(pieceStart, 8));
+            }
+        }
+    }
+
+    // The export workload renders the matches of a fixed TID range
+    string exportDirectory = (filesystem::temp_directory_path() / ("rsChecksumBenchmark" + to_string(steady_clock::now().time_since_epoch().count()))).string();
+    filesystem::create_directories(exportDirectory);
+    string exportBinaryPath = exportDirectory + "/matches.bin";
+    string snapshotPath = exportDirectory + "/inputSnapshot.bin";
+    vector<SnapshotInput> snapshotInputs = { describeSnapshotInput("enemyDataList.csv"), describeSnapshotInput("dataOrder.csv"), describeSnapshotInput("OTIDs.csv") };
+    writeInputSnapshot(snapshotPath, snapshotInputs, enemyList, enemyDict, dataOrderOrder, otidTable);
+    vector<SweepTile> exportTiles = buildSweepTiles(BENCHMARK_TID, BENCHMARK_TID + BENCHMARK_EXPORT_TIDS - 1, 0, frames, frames);
+    uint64_t exportRecords = 0;
+    {
+        ResultSink sink(exportBinaryPath, "", matchFileHeaderBytes(monCount, BENCHMARK_PID), "", ios::binary, exportTiles.size(), MAX_BENCHMARK_BUFFERED_OUTPUT);
+        for (size_t tileIndex = 0; tileIndex < exportTiles.size(); tileIndex++) {
+            TileOutput output = sink.acquire();
+            calculateChecksumMatchesThread(exportTiles[tileIndex], *context, context->engine, output);
+            exportRecords += output.matches.size() / sizeof(MatchRecord);
+            sink.submit(tileIndex, move(output));
+        }
+        sink.close();
+    }
+
+    vector<BenchmarkResult> results = vector<BenchmarkResult>();
+    results.push_back(runBenchmark("calculateMatch", "pair", repeats, [&context, playerKey]() {
+        uint64_t matches = 0;
+        for (int frame = 0; frame < BENCHMARK_MATCH_FRAMES; frame++) {
+            long long enemyKey = context->enemyKeyIndex.keys[frame];
+            for (const MonRecord &record : context->monTable.records) {
+                matches += calculateMatch(record, playerKey, enemyKey).match;
+            }
+        }
+        benchmarkSink = benchmarkSink + matches;
+        return (uint64_t)BENCHMARK_MATCH_FRAMES * context->monTable.records.size();
+        }));
+    results.push_back(runBenchmark("hexStringToIntLittleEndian", "call", repeats, [&hexStrings]() {
+        long long folded = 0;
+        for (const string &hexString : hexStrings) {
+            folded ^= hexStringToIntLittleEndian(hexString);
+        }
+        benchmarkSink = benchmarkSink + folded;
+        return (uint64_t)hexStrings.size();
+        }));
+    results.push_back(runBenchmark("dataFileToMap", "row", repeats, []() {
+        vector<string> loadedList = {};
+        map<string, vector<long long>> loadedDict = dataFileToMap("enemyDataList.csv", loadedList);
+        benchmarkSink = benchmarkSink + loadedDict.size();
+        return (uint64_t)loadedList.size();
+        }));
+    results.push_back(runBenchmark("otidFileToTable", "row", repeats, []() {
+        OtidTable loadedTable = otidFileToTable("OTIDs.csv");
+        benchmarkSink = benchmarkSink + loadedTable.tids.back();
+        return (uint64_t)loadedTable.tids.size();
+        }));
+    results.push_back(runBenchmark("loadInputSnapshot", "row", repeats, [&snapshotPath]() {
+        InputSnapshot snapshot;
+        vector<string> loadedList = {};
+        map<string, vector<long long>> loadedDict = map<string, vector<long long>>();
+        map<string, vector<int>> loadedOrder = map<string, vector<int>>();
+        OtidTable loadedTable = OtidTable();
+        if (snapshot.open(snapshotPath)) {
+            snapshot.loadTables(loadedList, loadedDict, loadedOrder);
+            snapshot.loadOtids(loadedTable);
+        }
+        benchmarkSink = benchmarkSink + loadedDict.size() + loadedTable.tids.size();
+        return (uint64_t)max(loadedList.size() + loadedTable.tids.size(), (size_t)1);
+        }));
+    results.push_back(runBenchmark("calculateChecksumMatchesThread", "pair", repeats, [&context, frames, monCount]() {
+        TileOutput output = TileOutput();
+        SweepTile tile = { BENCHMARK_TID, 0, frames };
+        calculateChecksumMatchesThread(tile, *context, context->engine, output);
+        benchmarkSink = benchmarkSink + output.matches.size();
+        return (uint64_t)frames * monCount;
+        }));
+    results.push_back(runBenchmark("exportMatches", "record", repeats, [&context, &exportDirectory, &exportBinaryPath, exportRecords]() {
+        exportMatches(exportBinaryPath, context->otidTable, context->enemyList, EXPORT_CSV, ExportSlice(), 1, exportDirectory + "/matches.csv", exportDirectory + "/aces.csv");
+        benchmarkSink = benchmarkSink + filesystem::file_size(exportDirectory + "/matches.csv");
+        return max(exportRecords, (uint64_t)1);
+        }));
+    filesystem::remove_all(exportDirectory);
+
+    map<string, double> baseline = map<string, double>();
+    bool haveBaseline = !options.count("write-baseline") && readBenchmarkBaseline(baselinePath, baseline);
+    int regressions = 0;
+    cout << left << setw(32) << "benchmark" << right << setw(12) << "units" << setw(14) << "ns/unit" << setw(16) << "units/s" << setw(14) << "baseline" << setw(10) << "change" << endl;
+    for (const BenchmarkResult &result : results) {
+        double nsPerUnit = result.seconds * 1e9 / result.units;
+        cout << fixed << setprecision(3) << left << setw(32) << result.name << right << setw(12) << result.units << setw(14) << nsPerUnit
+            << setprecision(0) << setw(16) << result.units / result.seconds;
+        if (haveBaseline && baseline.count(result.name)) {
+            double change = nsPerUnit / baseline[result.name] - 1;
+            bool regressed = change > tolerance;
+            regressions += regressed ? 1 : 0;
+            cout << setprecision(3) << setw(14) << baseline[result.name] << setprecision(1) << setw(9) << change * 100 << "%" << (regressed ? "  REGRESSED" : "");
+        }
+        cout << "  ns per " << result.unit << endl;
+    }
+
+    if (options.count("write-baseline")) {
+        writeBenchmarkBaseline(baselinePath, results);
+        cout << "Baseline written to " << baselinePath << endl;
+        return 0;
+    }
+    if (!haveBaseline) {
+        cout << "No baseline at " << baselinePath << ", run with --write-baseline to record one." << endl;
+        return 0;
+    }
+    if (regressions > 0) {
+        cout << regressions << " benchmark" << (regressions > 1 ? "s" : "") << " slower than the baseline by more than " << setprecision(0) << tolerance * 100 << "%." << endl;
+        return 1;
+    }
+    return 0;
+}
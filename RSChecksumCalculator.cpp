@@ -11,78 +11,806 @@
 #include <sstream>
 #include <thread>
 #include <mutex>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include "RSChecksumCalculator.h"
 #include "ThreadPool.h"
+#include "MonTable.h"
+#include "MatchEngine.h"
+#include "MatchFilter.h"
+#include "OtidTable.h"
+#include "RunContext.h"
+#include "SweepTile.h"
+#include "ResultSink.h"
+#include "MatchRecord.h"
+#include "MatchExport.h"
+#include "OtidGenerator.h"
+#include "RunManifest.h"
+#include "ResultCache.h"
+#include "QueryServer.h"
+#include "MatchMerge.h"
+#include "RunMetrics.h"
+#include "Profiler.h"
+#include "InputSnapshot.h"
+#include "MatchAggregate.h"
+#include "EarliestHits.h"
+#include "AutoTune.h"
+#include "MappedFile.h"
+#include "ResultStore.h"
 
 using namespace std;
 using namespace chrono;
 
-const long long PID = 1321080;
+const long long DEFAULT_PID = 1321080;
 const int DATA_ORDER_G = 1;
 const int DATA_ORDER_A = 4;
 const int DATA_ORDER_E = 7;
 const int DATA_ORDER_M = 10;
-const string CSV_HEADER = "Player frame,Enemy Frame,Player TID/SID,Enemy TID/SID,Species,Held Item,Moves,Pokeball,Egg,Enemy Mon";
-const string MATCH_FOLDER = "./cppMatches";
-const string ACE_FOLDER = "./cppAces";
-
-struct ChecksumMatchResults {
-    bool match;
-    bool ace;
-    long long keyXorData0;
-    long long keyXorData3;
-    long long keyXorData4;
-    long long keyXorData10;
-};
+const string COMBINED_MATCH_BINARY = "./combinedMatches.bin";
+const string COMBINED_MATCH_FILE = "./combinedMatches.csv";
+const string COMBINED_ACE_FILE = "./combinedAces.csv";
+const size_t MAX_BUFFERED_OUTPUT = 64 * 1024 * 1024;
+const string DEFAULT_CACHE_DIRECTORY = "./resultCache";
+const double DEFAULT_PROGRESS_SECONDS = 1.0;
+const string DEFAULT_INPUT_SNAPSHOT = "./inputSnapshot.bin";
+const int EARLIEST_WAVE_TIDS = 4096;
+const int AUTOTUNE_TIDS = 16;
+const int AUTOTUNE_FRAMES = 32768;
+const int AUTOTUNE_REPEATS = 3;
+const int EARLIEST_TILE_FRAMES = 1024;
 
+// The benchmark links these functions with its own main
+#ifndef RSCHECKSUM_NO_MAIN
 int main(int argc, char* argv[]) {
     steady_clock::time_point start = steady_clock::now();
-    
+    if (argc >= 2 && string(argv[1]) == "export") {
+        return runExport(argc, argv);
+    }
+    if (argc >= 2 && string(argv[1]) == "merge") {
+        return runMerge(argc, argv);
+    }
+    if (argc >= 2 && string(argv[1]) == "query") {
+        return runQuery(argc, argv);
+    }
+
     // Argument Parsing
     vector<int> arguments = parseArguments(argc, argv);
-    handleArguments(arguments);
+    map<string, string> options = parseOptions(argc, argv);
+    if (options.count("profile")) {
+        enableProfiler();
+    }
+    if (options.count("build-snapshot")) {
+        return buildInputSnapshot(options);
+    }
+
+    // Parsed tables are read from the snapshot for every input that hasn't changed since it was built
+    InputSnapshot snapshot;
+    bool useSnapshot = false;
+    if (!options.count("no-snapshot")) {
+        string snapshotPath = options.count("snapshot") && !options["snapshot"].empty() ? options["snapshot"] : DEFAULT_INPUT_SNAPSHOT;
+        useSnapshot = snapshot.open(snapshotPath);
+        if (!useSnapshot && options.count("snapshot")) {
+            cout << "Snapshot " << snapshotPath << " is missing or damaged, parsing the data files." << endl;
+        }
+    }
+
+    // TIDs and SIDs come from the LCRNG unless an OTID file is given
+    OtidTable otidTable = OtidTable();
+    uint32_t otidSeed = options.count("seed") ? stoul(options["seed"], 0, 0) : DEFAULT_OTID_SEED;
+    int maxAdvance = MAX_GENERATED_ADVANCE;
+    if (options.count("otids")) {
+        string otidPath = options["otids"].empty() ? "OTIDs.csv" : options["otids"];
+        ProfileScope scope("loadOtids");
+        if (useSnapshot && snapshot.otidsCurrent(otidPath)) {
+            snapshot.loadOtids(otidTable);
+        } else {
+            otidTable = otidFileToTable(otidPath);
+        }
+        if (otidTable.tids.empty()) {
+            cout << "No OTIDs found in " << options["otids"] << endl;
+            return 1;
+        }
+        maxAdvance = otidTable.tids.size() - 1;
+    }
+
+    // A tuned profile for this host fills in every setting not given on the command line
+    HostFingerprint host = readHostFingerprint();
+    string tuneProfilePath = options.count("tune-profile") && !options["tune-profile"].empty() ? options["tune-profile"] : defaultTuneProfilePath(host);
+    TuneConfig tuned = TuneConfig();
+    bool haveTuned = !options.count("autotune") && !options.count("no-tune") && readTuneProfile(tuneProfilePath, host, tuned);
+    int positionalCount = count_if(argv, argv + argc, [](char* arg) {
+        return string(arg).rfind("--", 0) != 0;
+        });
+    if (haveTuned) {
+        cout << "Using the tuned settings in " << tuneProfilePath << endl;
+        if (positionalCount < 5) {
+            arguments[3] = tuned.threads;
+        }
+    }
+    if (options.count("autotune")) {
+        arguments[2] = max(arguments[2], AUTOTUNE_FRAMES);
+    }
+    handleArguments(arguments, maxAdvance);
+    vector<long long> pids = vector<long long>();
+    try {
+        pids = parsePidList(options.count("pid") ? options["pid"] : to_string(DEFAULT_PID));
+    }
+    catch (const exception &error) {
+        cout << "Invalid PID list: " << error.what() << endl;
+        return 1;
+    }
+    int shardIndex = 0;
+    int shardCount = 1;
+    if (options.count("shard") && !parseShard(options["shard"], shardIndex, shardCount)) {
+        cout << "Invalid shard " << options["shard"] << ", use <shard>/<shards> such as 1/4." << endl;
+        return 1;
+    }
+    MatchFilter filter = MatchFilter();
+    try {
+        filter = parseMatchFilter(options["filter"]);
+    }
+    catch (const exception &error) {
+        cout << "Invalid filter: " << error.what() << endl;
+        return 1;
+    }
+    ChecksumKernel kernel = haveTuned ? tuned.kernel : detectChecksumKernel();
+    if (options.count("kernel") && (!parseChecksumKernel(options["kernel"], kernel) || !checksumKernelSupported(kernel))) {
+        cout << "Kernel " << options["kernel"] << " is not available on this CPU." << endl;
+        return 1;
+    }
+    int tileFrames = haveTuned ? tuned.tileFrames : DEFAULT_TILE_FRAMES;
+    int blockFrames = haveTuned ? tuned.blockFrames : 0;
+    int blockMons = haveTuned ? tuned.blockMons : 0;
+    try {
+        tileFrames = options.count("tile-frames") ? stoi(options["tile-frames"]) : tileFrames;
+        blockFrames = options.count("block-frames") ? stoi(options["block-frames"]) : blockFrames;
+        blockMons = options.count("block-mons") ? stoi(options["block-mons"]) : blockMons;
+    }
+    catch (const exception &) {
+        cout << "--tile-frames, --block-frames and --block-mons take numbers." << endl;
+        return 1;
+    }
+    if (tileFrames < 1) {
+        cout << "Tile frame lower bound exceeded, set to 1." << endl;
+        tileFrames = 1;
+    }
 
     // Parse Data Files
     vector<string> enemyList = {};
-    map<string, vector<long long>> enemyDict = dataFileToMap("enemyDataList.csv", enemyList);
-    vector<vector<int>> otidVector = otidFileToVector("OTIDs.csv");
+    map<string, vector<long long>> enemyDict = map<string, vector<long long>>();
+    map<string, vector<int>> dataOrderOrder = map<string, vector<int>>();
+    {
+        ProfileScope scope("loadData");
+        if (useSnapshot && snapshot.tablesCurrent("enemyDataList.csv", "dataOrder.csv")) {
+            snapshot.loadTables(enemyList, enemyDict, dataOrderOrder);
+        } else {
+            enemyDict = dataFileToMap("enemyDataList.csv", enemyList);
+            dataOrderOrder = dataOrderToMap("dataOrder.csv");
+        }
+    }
+    if (!options.count("otids")) {
+        ProfileScope scope("generateOtids");
+        otidTable = generateOtidTable(otidSeed, max(arguments[1] + 1, arguments[2]), arguments[3]);
+    }
     string dataOrder[24] = {
         "GAEM", "GAME", "GEAM", "GEMA", "GMAE", "GMEA",
         "AGEM", "AGME", "AEGM", "AEMG", "AMGE", "AMEG",
         "EGAM", "EGMA", "EAGM", "EAMG", "EMGA", "EMAG",
         "MGAE", "MGEA", "MAGE", "MAEG", "MEGA", "MEAG"
     };
-    map<string, vector<int>> dataOrderOrder = dataOrderToMap("dataOrder.csv");
 
-    // Create Directory
+    // Everything the workers read is built once and shared read-only
+    shared_ptr<const RunContext> context = nullptr;
+    {
+        ProfileScope scope("buildContext");
+        shared_ptr<RunContext> builtContext = make_shared<RunContext>(pids[0], arguments[2], filter, kernel, dataOrder, dataOrderOrder, move(enemyList), enemyDict, move(otidTable));
+        builtContext->engine.setBlocking(blockFrames, blockMons);
+        if (options.count("pin") || options.count("numa")) {
+            builtContext->pinWorkers(arguments[3]);
+        }
+        if (options.count("numa")) {
+            builtContext->placeOnNumaNodes();
+        }
+        if (options.count("autotune")) {
+            return runAutotune(*builtContext, arguments, host, tuneProfilePath);
+        }
+        context = builtContext;
+    }
+
+    if (options.count("serve")) {
+        return runQueryServer(*context, arguments[3], cin, cout);
+    }
+    RunMetrics metrics = RunMetrics();
+    metrics.addPhase("parse", steady_clock::now() - start);
+    double progressSeconds = DEFAULT_PROGRESS_SECONDS;
     try {
-        filesystem::remove_all(MATCH_FOLDER);
-        filesystem::remove_all(ACE_FOLDER);
-    }
-    catch (int _) {}
-	try {
-		filesystem::create_directory(MATCH_FOLDER);
-		filesystem::create_directory(ACE_FOLDER);
-	}
-	catch (int errorCode) {
-		cout << "Error creating output directories: " << errorCode << endl;
-		return 1;
-	}
-
-    // Calculate checksums
-    cout << "Calculating checksums" << endl;
-    calculateChecksums(arguments, dataOrder, dataOrderOrder, enemyList, enemyDict, otidVector);
-
-    cout << "Writing to file" << endl;
-    // Combine checksum files
-    combineChecksumFiles();
+        progressSeconds = options.count("progress") ? stod(options["progress"]) : DEFAULT_PROGRESS_SECONDS;
+    }
+    catch (const exception &) {
+        cout << "--progress takes seconds between progress lines, such as --progress=5, or 0 for none." << endl;
+        return 1;
+    }
+
+    // The PID is in both the player and enemy key, so it cancels out of
+    // keysXored and every PID has the same matches. One sweep serves them all.
+    string matchBinaryPath = pidFileName(COMBINED_MATCH_BINARY, pids, 0);
+    string shardSuffix = shardCount > 1 ? "_shard" + to_string(shardIndex + 1) + "of" + to_string(shardCount) : "";
+    string metricsPath = options.count("metrics") ? options["metrics"] : "./runMetrics" + shardSuffix + ".json";
+    if (shardCount > 1) {
+        // Shards only write their binary file, merge combines them into the csv files
+        matchBinaryPath = matchBinaryPath.substr(0, matchBinaryPath.rfind(".")) + shardSuffix + ".bin";
+        options["binary-only"] = "";
+    }
+
+    // The manifest records what the run computes and how many tiles are in the binary file
+    string manifestPath = matchBinaryPath.substr(0, matchBinaryPath.rfind(".")) + ".manifest";
+    RunManifest manifest = RunManifest();
+    manifest.parameters["pids"] = options.count("pid") ? options["pid"] : to_string(DEFAULT_PID);
+    manifest.parameters["tids"] = to_string(arguments[0]) + "-" + to_string(arguments[1]);
+    manifest.parameters["frames"] = to_string(arguments[2]);
+    manifest.parameters["tileFrames"] = to_string(tileFrames);
+    manifest.parameters["shard"] = to_string(shardIndex + 1) + "/" + to_string(shardCount);
+    manifest.parameters["filter"] = options["filter"];
+    // Inputs unchanged since the snapshot reuse its hashes instead of reading the files again
+    auto inputHash = [&snapshot, useSnapshot](string path) {
+        string hash = useSnapshot ? snapshot.inputHash(path) : "";
+        return hash.empty() ? hashFile(path) : hash;
+    };
+    manifest.parameters["otids"] = options.count("otids") ? "csv " + inputHash(options["otids"].empty() ? "OTIDs.csv" : options["otids"]) : "seed " + to_string(otidSeed);
+    manifest.parameters["enemyDataList"] = inputHash("enemyDataList.csv");
+    manifest.parameters["dataOrder"] = inputHash("dataOrder.csv");
+    if (options.count("earliest")) {
+        // Only each TID's earliest matches are kept, there is no match file to cache, resume or export
+        if (options.count("cache") || options.count("resume")) {
+            cout << "Earliest runs don't write a match file, ignoring --cache and --resume." << endl;
+        }
+        int hitsPerTid = 1;
+        try {
+            hitsPerTid = options["earliest"].empty() ? 1 : max(1, stoi(options["earliest"]));
+        }
+        catch (const exception &) {
+            cout << "--earliest takes a number of matches per TID, such as --earliest=3." << endl;
+            return 1;
+        }
+        int earliestTileFrames = options.count("tile-frames") ? tileFrames : EARLIEST_TILE_FRAMES;
+        string earliestPath = options.count("out") ? options["out"] : "./earliestMatches" + shardSuffix + ".csv";
+        calculateEarliest(arguments, earliestTileFrames, *context, hitsPerTid, options.count("per-mon") > 0, earliestPath, shardIndex, shardCount, metrics, progressSeconds);
+    } else if (options.count("aggregate")) {
+        // Matches are only counted, so there is no match file to cache, resume or export
+        if (options.count("cache") || options.count("resume")) {
+            cout << "Aggregate runs don't write matches, ignoring --cache and --resume." << endl;
+        }
+        string histogramPath = options["aggregate"].empty() ? "./aggregateMatches" + shardSuffix + ".csv" : options["aggregate"];
+        calculateAggregate(arguments, tileFrames, *context, histogramPath, shardIndex, shardCount, metrics, progressSeconds);
+    } else {
+        if (options.count("cache") && (filter.active || shardCount > 1)) {
+            cout << "The result cache only holds unfiltered, unsharded runs, calculating without it." << endl;
+        }
+        if (options.count("cache") && !filter.active && shardCount == 1) {
+            // Only blocks missing from the cache are calculated, the rest is read back
+            string cacheDirectory = options["cache"].empty() ? DEFAULT_CACHE_DIRECTORY : options["cache"];
+            cout << "Calculating checksums" << (pids.size() > 1 ? " once for " + to_string(pids.size()) + " PIDs" : "") << " with the cache in " << cacheDirectory << endl;
+            calculateCachedChecksums(arguments, tileFrames, *context, matchBinaryPath, cacheDirectory, manifest.parameters["otids"], metrics, progressSeconds);
+        } else {
+            if (options.count("resume")) {
+                RunManifest previousManifest = RunManifest();
+                if (!readRunManifest(manifestPath, previousManifest)) {
+                    cout << "No manifest to resume from, starting a new run." << endl;
+                } else if (manifestMismatch(manifest, previousManifest) != "") {
+                    cout << "Cannot resume, " << manifestMismatch(manifest, previousManifest) << " differs from " << manifestPath << endl;
+                    return 1;
+                } else if (!filesystem::exists(matchBinaryPath) || filesystem::file_size(matchBinaryPath) < previousManifest.committedBytes) {
+                    cout << "Cannot resume, " << matchBinaryPath << " is shorter than " << manifestPath << " records." << endl;
+                    return 1;
+                } else {
+                    // Drop anything written after the last checkpoint
+                    filesystem::resize_file(matchBinaryPath, previousManifest.committedBytes);
+                    manifest.committedTiles = previousManifest.committedTiles;
+                    manifest.committedBytes = previousManifest.committedBytes;
+                    cout << "Resuming after " << manifest.committedTiles << " finished tiles." << endl;
+                }
+            }
+
+            cout << "Calculating checksums" << (pids.size() > 1 ? " once for " + to_string(pids.size()) + " PIDs" : "") << endl;
+            calculateChecksums(arguments, tileFrames, *context, matchBinaryPath, manifest, manifestPath, shardIndex, shardCount, metrics, progressSeconds);
+        }
+    }
+
+    // Render the binary results as csv unless only the binary file is wanted
+    string matchPath = pidFileName(COMBINED_MATCH_FILE, pids, 0);
+    string acePath = pidFileName(COMBINED_ACE_FILE, pids, 0);
+    if (!options.count("binary-only") && !options.count("aggregate") && !options.count("earliest")) {
+        cout << "Exporting matches" << endl;
+        steady_clock::time_point exportStart = steady_clock::now();
+        ProfileScope scope("export");
+        exportMatches(matchBinaryPath, context->otidTable, context->enemyList, EXPORT_CSV, ExportSlice(), arguments[3], matchPath, acePath);
+        metrics.addPhase("export", steady_clock::now() - exportStart);
+    }
+
+    // The indexed store answers lookups without scanning, shards get theirs when merged
+    if (shardCount == 1 && !options.count("no-store") && !options.count("aggregate") && !options.count("earliest")) {
+        steady_clock::time_point storeStart = steady_clock::now();
+        ProfileScope scope("store");
+        if (!buildResultStore(matchBinaryPath, resultStorePath(matchBinaryPath))) {
+            cout << "Could not write " << resultStorePath(matchBinaryPath) << endl;
+        }
+        metrics.addPhase("store", steady_clock::now() - storeStart);
+    }
+
+    // Each further PID gets a copy of the results tagged with its PID
+    for (size_t pidIndex = 1; pidIndex < pids.size() && shardCount == 1 && !options.count("aggregate") && !options.count("earliest"); pidIndex++) {
+        string pidMatchBinaryPath = pidFileName(COMBINED_MATCH_BINARY, pids, pidIndex);
+        filesystem::copy_file(matchBinaryPath, pidMatchBinaryPath, filesystem::copy_options::overwrite_existing);
+        setMatchFilePid(pidMatchBinaryPath, pids[pidIndex]);
+        if (!options.count("binary-only")) {
+            filesystem::copy_file(matchPath, pidFileName(COMBINED_MATCH_FILE, pids, pidIndex), filesystem::copy_options::overwrite_existing);
+            filesystem::copy_file(acePath, pidFileName(COMBINED_ACE_FILE, pids, pidIndex), filesystem::copy_options::overwrite_existing);
+        }
+    }
 
     // Check Time Elapsed
     steady_clock::time_point end = steady_clock::now();
-    cout << "Time elapsed: " << (duration_cast<microseconds> (end - start).count()) / 1000000 << " seconds" << std::endl;
+    metrics.addPhase("total", end - start);
+    map<string, string> runInfo = map<string, string>();
+    runInfo["tids"] = "[" + to_string(arguments[0]) + ", " + to_string(arguments[1]) + "]";
+    runInfo["frames"] = to_string(arguments[2]);
+    runInfo["threads"] = to_string(arguments[3]);
+    runInfo["mons"] = to_string(context->monTable.monCount);
+    runInfo["pids"] = to_string(pids.size());
+    runInfo["shard"] = "\"" + to_string(shardIndex + 1) + "/" + to_string(shardCount) + "\"";
+    runInfo["kernel"] = "\"" + checksumKernelName(context->engine.kernel()) + "\"";
+    runInfo["numaNodes"] = to_string(context->topology.nodeCpus.size());
+    runInfo["pinned"] = context->workerCpus.empty() ? "false" : "true";
+    metrics.writeJson(metricsPath, runInfo);
+    if (profilerEnabled()) {
+        string profilePrefix = options["profile"].empty() ? "./profile" + shardSuffix : options["profile"];
+        writeProfile(profilePrefix + ".json", profilePrefix + "Report.txt");
+        cout << "Profile written to " << profilePrefix << ".json and " << profilePrefix << "Report.txt, " << profilerCounterStatus() << endl;
+    }
+    cout << "Time elapsed: " << fixed << setprecision(3) << duration<double>(end - start).count() << " seconds" << std::endl;
+    return 0;
+}
+#endif
+
+/* ******************************************************
+ * Purpose: Parses the data files once and writes them
+ *   as a snapshot later runs map instead of parsing.
+ *   RSChecksumCalculator --build-snapshot[=path]
+ *     [--otids[=file]]
+ *   The OTID file is included when given or when
+ *   OTIDs.csv is present.
+ * ******************************************************
+ * Parameters:
+ *   options: parsed command line options
+ * ******************************************************
+*/
+int buildInputSnapshot(map<string, string> &options) {
+    string snapshotPath = options["build-snapshot"].empty() ? DEFAULT_INPUT_SNAPSHOT : options["build-snapshot"];
+    string otidPath = options.count("otids") && !options["otids"].empty() ? options["otids"] : "OTIDs.csv";
+    vector<SnapshotInput> inputs = { describeSnapshotInput("enemyDataList.csv"), describeSnapshotInput("dataOrder.csv") };
+    vector<string> enemyList = {};
+    map<string, vector<long long>> enemyDict = dataFileToMap("enemyDataList.csv", enemyList);
+    map<string, vector<int>> dataOrderOrder = dataOrderToMap("dataOrder.csv");
+    if (enemyList.empty() || dataOrderOrder.empty()) {
+        cout << "Build the snapshot from the directory with enemyDataList.csv and dataOrder.csv." << endl;
+        return 1;
+    }
+    OtidTable otidTable = OtidTable();
+    if (filesystem::exists(otidPath)) {
+        inputs.push_back(describeSnapshotInput(otidPath));
+        otidTable = otidFileToTable(otidPath);
+    }
+    if (!writeInputSnapshot(snapshotPath, inputs, enemyList, enemyDict, dataOrderOrder, otidTable)) {
+        cout << "Could not write " << snapshotPath << endl;
+        return 1;
+    }
+    cout << "Snapshot of " << enemyList.size() << " enemy mons, " << dataOrderOrder.size() << " data orders and " << otidTable.tids.size() << " OTIDs written to " << snapshotPath << endl;
+    return 0;
+}
+
+/* ******************************************************
+ * Purpose: Renders a binary match file as csv or JSON
+ *   export <file.bin> [--format=csv|json] [--tids=a-b]
+ *     [--frames=a-b] [--threads=n] [--out=path]
+ *     [--aces=path] [--seed=n | --otids=path]
+ * ******************************************************
+ * Parameters:
+ *   argc: Number of arguments
+ *   argv: Char* array of arguments
+ * ******************************************************
+*/
+int runExport(int argc, char* argv[]) {
+    map<string, string> options = parseOptions(argc, argv);
+    string matchBinaryPath = COMBINED_MATCH_BINARY;
+    if (argc >= 3 && string(argv[2]).rfind("--", 0) != 0) {
+        matchBinaryPath = argv[2];
+    }
+
+    ExportFormat format = EXPORT_CSV;
+    if (options.count("format") && options["format"] == "json") {
+        format = EXPORT_JSON;
+    } else if (options.count("format") && options["format"] != "csv") {
+        cout << "Unknown export format " << options["format"] << endl;
+        return 1;
+    }
+    ExportSlice slice = ExportSlice();
+    if (options.count("tids") && !parseRange(options["tids"], slice.tidStart, slice.tidEnd)) {
+        cout << "Invalid range " << options["tids"] << ", use <first>-<last> such as 10-20." << endl;
+        return 1;
+    }
+    if (options.count("frames") && !parseRange(options["frames"], slice.frameStart, slice.frameEnd)) {
+        cout << "Invalid range " << options["frames"] << ", use <first>-<last> such as 10-20." << endl;
+        return 1;
+    }
+    int threads = options.count("threads") ? stoi(options["threads"]) : 1;
+    threads = max(1, min(threads, (int)thread::hardware_concurrency()));
+    string extension = format == EXPORT_JSON ? ".json" : ".csv";
+    string matchPath = options.count("out") ? options["out"] : "./exportedMatches" + extension;
+    string acePath = "";
+    if (format == EXPORT_CSV) {
+        acePath = options.count("aces") ? options["aces"] : "./exportedAces.csv";
+    }
+
+    vector<string> enemyList = {};
+    dataFileToMap("enemyDataList.csv", enemyList);
+    OtidTable otidTable = OtidTable();
+    if (!loadMatchFileOtids(options, matchBinaryPath, threads, otidTable)) {
+        cout << "Not enough OTIDs for " << matchBinaryPath << endl;
+        return 1;
+    }
+    if (!exportMatches(matchBinaryPath, otidTable, enemyList, format, slice, threads, matchPath, acePath)) {
+        cout << matchBinaryPath << " is not a match file for enemyDataList.csv" << endl;
+        return 1;
+    }
+    cout << "Exported " << matchPath << endl;
     return 0;
 }
 
+/* ******************************************************
+ * Purpose: Loads the TIDs and SIDs a binary match file
+ *   needs, from --otids or the LCRNG with --seed
+ * ******************************************************
+ * Parameters:
+ *   options: parsed options
+ *   matchBinaryPath: binary match file
+ *   threads: number of threads to generate with
+ *   otidTable: Outputs TID and SID per advance
+ * ******************************************************
+*/
+bool loadMatchFileOtids(map<string, string> &options, string matchBinaryPath, int threads, OtidTable &otidTable) {
+    return loadAdvanceOtids(options, matchFileAdvances(matchBinaryPath), threads, otidTable);
+}
+
+/* ******************************************************
+ * Purpose: Loads at least a number of advances of TIDs
+ *   and SIDs, from --otids or the LCRNG with --seed
+ * ******************************************************
+ * Parameters:
+ *   options: parsed options
+ *   advances: advances needed
+ *   threads: number of threads to generate with
+ *   otidTable: Outputs TID and SID per advance
+ * ******************************************************
+*/
+bool loadAdvanceOtids(map<string, string> &options, int advances, int threads, OtidTable &otidTable) {
+    if (options.count("otids")) {
+        otidTable = otidFileToTable(options["otids"].empty() ? "OTIDs.csv" : options["otids"]);
+    } else {
+        uint32_t otidSeed = options.count("seed") ? stoul(options["seed"], 0, 0) : DEFAULT_OTID_SEED;
+        otidTable = generateOtidTable(otidSeed, advances, threads);
+    }
+    return otidTable.tids.size() >= (size_t)advances;
+}
+
+/* ******************************************************
+ * Purpose: Merges shard outputs into one binary match
+ *   file and renders it as csv
+ *   merge <shard.bin>... [--out=path] [--threads=n]
+ *     [--binary-only] [--seed=n | --otids=path]
+ * ******************************************************
+ * Parameters:
+ *   argc: Number of arguments
+ *   argv: Char* array of arguments
+ * ******************************************************
+*/
+int runMerge(int argc, char* argv[]) {
+    map<string, string> options = parseOptions(argc, argv);
+    vector<string> inputPaths = vector<string>();
+    for (int argIndex = 2; argIndex < argc; argIndex++) {
+        if (string(argv[argIndex]).rfind("--", 0) != 0) {
+            inputPaths.push_back(argv[argIndex]);
+        }
+    }
+    if (inputPaths.empty()) {
+        cout << "No match files to merge." << endl;
+        return 1;
+    }
+    int threads = options.count("threads") ? stoi(options["threads"]) : 1;
+    threads = max(1, min(threads, (int)thread::hardware_concurrency()));
+    string matchBinaryPath = options.count("out") ? options["out"] : COMBINED_MATCH_BINARY;
+
+    cout << "Merging " << inputPaths.size() << " match files into " << matchBinaryPath << endl;
+    if (!mergeMatchFiles(inputPaths, threads, matchBinaryPath)) {
+        return 1;
+    }
+    if (!options.count("no-store") && !buildResultStore(matchBinaryPath, resultStorePath(matchBinaryPath))) {
+        cout << "Could not write " << resultStorePath(matchBinaryPath) << endl;
+    }
+    if (options.count("binary-only")) {
+        return 0;
+    }
+
+    vector<string> enemyList = {};
+    dataFileToMap("enemyDataList.csv", enemyList);
+    OtidTable otidTable = OtidTable();
+    if (!loadMatchFileOtids(options, matchBinaryPath, threads, otidTable)) {
+        cout << "Not enough OTIDs for " << matchBinaryPath << endl;
+        return 1;
+    }
+    if (!exportMatches(matchBinaryPath, otidTable, enemyList, EXPORT_CSV, ExportSlice(), threads, COMBINED_MATCH_FILE, COMBINED_ACE_FILE)) {
+        cout << matchBinaryPath << " is not a match file for enemyDataList.csv" << endl;
+        return 1;
+    }
+    return 0;
+}
+
+/* ******************************************************
+ * Purpose: Answers lookups from a result store by seeking
+ *   its indexes, streaming the matching rows as csv or
+ *   JSON lines
+ *   query [file.store] [--tid=n] [--frame=n] [--mon=name]
+ *     [--species=n] [--aces] [--limit=n]
+ *     [--format=csv|json] [--out=path]
+ *     [--seed=n | --otids=path]
+ *   With several conditions the most selective index is
+ *   read and the other conditions are checked per row.
+ * ******************************************************
+ * Parameters:
+ *   argc: Number of arguments
+ *   argv: Char* array of arguments
+ * ******************************************************
+*/
+int runQuery(int argc, char* argv[]) {
+    map<string, string> options = parseOptions(argc, argv);
+    string storePath = resultStorePath(COMBINED_MATCH_BINARY);
+    if (argc >= 3 && string(argv[2]).rfind("--", 0) != 0) {
+        storePath = argv[2];
+    }
+    ResultStore store;
+    if (!store.open(storePath)) {
+        cout << storePath << " is not a result store, a sweep or merge writes one next to its binary match file." << endl;
+        return 1;
+    }
+    ExportFormat format = EXPORT_CSV;
+    if (options.count("format") && options["format"] == "json") {
+        format = EXPORT_JSON;
+    } else if (options.count("format") && options["format"] != "csv") {
+        cout << "Unknown query format " << options["format"] << endl;
+        return 1;
+    }
+    vector<string> enemyList = {};
+    dataFileToMap("enemyDataList.csv", enemyList);
+    if ((int)enemyList.size() != store.monCount()) {
+        cout << storePath << " is not a store for enemyDataList.csv" << endl;
+        return 1;
+    }
+
+    // Each condition is a key and the values it accepts, a mon name can be on several mons
+    vector<pair<StoreKey, vector<uint32_t>>> conditions = vector<pair<StoreKey, vector<uint32_t>>>();
+    uint64_t limit = UINT64_MAX;
+    try {
+        if (options.count("tid")) {
+            conditions.push_back({ STORE_KEY_TID, { (uint32_t)stoul(options["tid"], 0, 0) } });
+        }
+        if (options.count("frame")) {
+            conditions.push_back({ STORE_KEY_FRAME, { (uint32_t)stoul(options["frame"], 0, 0) } });
+        }
+        if (options.count("species")) {
+            conditions.push_back({ STORE_KEY_SPECIES, { (uint32_t)stoul(options["species"], 0, 0) } });
+        }
+        if (options.count("limit")) {
+            limit = stoull(options["limit"]);
+        }
+    }
+    catch (const exception &) {
+        cout << "--tid, --frame, --species and --limit take numbers." << endl;
+        return 1;
+    }
+    if (options.count("mon")) {
+        vector<uint32_t> monIndexes = vector<uint32_t>();
+        for (size_t monIndex = 0; monIndex < enemyList.size(); monIndex++) {
+            if (enemyList[monIndex] == options["mon"]) {
+                monIndexes.push_back(monIndex);
+            }
+        }
+        if (monIndexes.empty()) {
+            cout << "No mon named " << options["mon"] << " in enemyDataList.csv" << endl;
+            return 1;
+        }
+        conditions.push_back({ STORE_KEY_MON, monIndexes });
+    }
+    bool acesOnly = options.count("aces") > 0;
+
+    // Read the condition matching the fewest rows, without a condition every row in tid order
+    vector<pair<uint64_t, uint64_t>> ranges = { { 0, store.recordCount() } };
+    StoreKey scanKey = STORE_KEY_TID;
+    uint64_t scanRows = store.recordCount();
+    for (const pair<StoreKey, vector<uint32_t>> &condition : conditions) {
+        vector<pair<uint64_t, uint64_t>> conditionRanges = vector<pair<uint64_t, uint64_t>>();
+        uint64_t conditionRows = 0;
+        for (uint32_t value : condition.second) {
+            uint64_t first = 0;
+            uint64_t last = 0;
+            store.equalRange(condition.first, value, first, last);
+            conditionRanges.push_back({ first, last });
+            conditionRows += last - first;
+        }
+        if (conditionRows <= scanRows) {
+            ranges = conditionRanges;
+            scanKey = condition.first;
+            scanRows = conditionRows;
+        }
+    }
+
+    OtidTable otidTable = OtidTable();
+    if (!loadAdvanceOtids(options, store.advances(), 1, otidTable)) {
+        cout << "Not enough OTIDs for " << storePath << endl;
+        return 1;
+    }
+    ofstream outFile;
+    if (options.count("out")) {
+        outFile.open(options["out"], ios::out | ios::trunc | ios::binary);
+    }
+    ostream &out = options.count("out") ? outFile : cout;
+    if (format == EXPORT_CSV) {
+        out << CSV_HEADER << "\n";
+    }
+
+    // Rows are formatted into a buffer and written in blocks as they are found
+    const size_t FLUSH_BYTES = 1 << 20;
+    string buffer = "";
+    uint64_t rowsWritten = 0;
+    for (const pair<uint64_t, uint64_t> &range : ranges) {
+        for (uint64_t position = range.first; position < range.second && rowsWritten < limit; position++) {
+            MatchRecord record = store.record(store.row(scanKey, position));
+            bool passes = !acesOnly || (record.flags & MATCH_FLAG_ACE);
+            for (size_t conditionIndex = 0; conditionIndex < conditions.size() && passes; conditionIndex++) {
+                StoreKey conditionKey = conditions[conditionIndex].first;
+                uint32_t value = conditionKey == STORE_KEY_TID ? record.tid : conditionKey == STORE_KEY_FRAME ? record.frame
+                    : conditionKey == STORE_KEY_MON ? record.monIndex : record.keyXorData0 & 0xFFFF;
+                const vector<uint32_t> &values = conditions[conditionIndex].second;
+                passes = find(values.begin(), values.end(), value) != values.end();
+            }
+            if (!passes) {
+                continue;
+            }
+            if (format == EXPORT_JSON) {
+                formatMatchJson(record, otidTable, enemyList, buffer);
+            } else {
+                formatMatchCsv(record, otidTable, enemyList, buffer);
+            }
+            rowsWritten++;
+            if (buffer.size() >= FLUSH_BYTES) {
+                out.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+    }
+    out.write(buffer.data(), buffer.size());
+    out.flush();
+    return 0;
+}
+
+/* ******************************************************
+ * Purpose: Parses a shard such as 2/4 into a 0 based
+ *   shard index and shard count
+ * ******************************************************
+ * Parameters:
+ *   shard: shard number from 1 to the count, / and count
+ *   shardIndex: Outputs the 0 based shard
+ *   shardCount: Outputs the number of shards
+ * ******************************************************
+*/
+bool parseShard(string shard, int &shardIndex, int &shardCount) {
+    size_t slashIndex = shard.find("/");
+    if (slashIndex == string::npos) {
+        return false;
+    }
+    try {
+        shardIndex = stoi(shard.substr(0, slashIndex)) - 1;
+        shardCount = stoi(shard.substr(slashIndex + 1));
+    }
+    catch (const exception &) {
+        return false;
+    }
+    return shardCount >= 1 && shardIndex >= 0 && shardIndex < shardCount;
+}
+
+/* ******************************************************
+ * Purpose: Parses an inclusive range such as 10-20, or a
+ *   single value
+ * ******************************************************
+ * Parameters:
+ *   range: range string
+ *   rangeStart: Outputs the first value
+ *   rangeEnd: Outputs the last value
+ * ******************************************************
+ * Returns: false if either end isn't a number
+ * ******************************************************
+*/
+bool parseRange(string range, int &rangeStart, int &rangeEnd) {
+    size_t dashIndex = range.find("-");
+    try {
+        rangeStart = stoi(range.substr(0, dashIndex));
+        rangeEnd = dashIndex == string::npos ? rangeStart : stoi(range.substr(dashIndex + 1));
+    }
+    catch (const exception &) {
+        return false;
+    }
+    return true;
+}
+
+/* ******************************************************
+ * Purpose: Parses a comma separated list of PIDs such as
+ *   "1321080,0x1a2b3c4d"
+ * ******************************************************
+ * Parameters:
+ *   pidString: comma separated decimal or 0x hex PIDs
+ * ******************************************************
+*/
+vector<long long> parsePidList(string pidString) {
+    vector<long long> pids = vector<long long>();
+    const string DELIMITER = ",";
+    size_t pidStart = 0;
+
+    while (pidStart < pidString.length()) {
+        size_t pidEnd = pidString.find(DELIMITER, pidStart);
+        if (pidEnd == string::npos) {
+            pidEnd = pidString.length();
+        }
+        string pidTerm = pidString.substr(pidStart, pidEnd - pidStart);
+        pidStart = pidEnd + 1;
+        if (pidTerm.empty()) {
+            continue;
+        }
+        long long pid = stoll(pidTerm, 0, 0);
+        if (pid < 0 || pid > 0xFFFFFFFFLL) {
+            throw invalid_argument("PID " + pidTerm + " must be between 0 and 0xffffffff");
+        }
+        if (find(pids.begin(), pids.end(), pid) == pids.end()) {
+            pids.push_back(pid);
+        }
+    }
+    if (pids.empty()) {
+        throw invalid_argument("no PIDs given");
+    }
+    return pids;
+}
+
+/* ******************************************************
+ * Purpose: Names an output file for one PID of a run.
+ *   A single PID keeps the plain file name, several PIDs
+ *   add _<pid> before the extension.
+ * ******************************************************
+ * Parameters:
+ *   fileName: plain output file name
+ *   pids: PIDs of the run
+ *   pidIndex: PID to name the file for
+ * ******************************************************
+*/
+string pidFileName(string fileName, const vector<long long> &pids, size_t pidIndex) {
+    if (pids.size() == 1) {
+        return fileName;
+    }
+    size_t extensionIndex = fileName.rfind(".");
+    return fileName.substr(0, extensionIndex) + "_" + to_string(pids[pidIndex]) + fileName.substr(extensionIndex);
+}
+
 /* ******************************************************
  * Purpose: Parses passed arguments and assigns defaults
  * ******************************************************
@@ -93,6 +821,17 @@ int main(int argc, char* argv[]) {
 */
 vector<int> parseArguments(int argc, char* argv[]) {
     vector<int> arguments = vector<int>();
+
+    // Options start with -- and can appear anywhere
+    vector<char*> positionalArgv = vector<char*>();
+    for (int argIndex = 0; argIndex < argc; argIndex++) {
+        if (string(argv[argIndex]).rfind("--", 0) != 0) {
+            positionalArgv.push_back(argv[argIndex]);
+        }
+    }
+    argc = positionalArgv.size();
+    argv = positionalArgv.data();
+
     if (argc >= 2) {
         string arg = argv[1];
         int startingTid = stoi(arg);
@@ -125,37 +864,63 @@ vector<int> parseArguments(int argc, char* argv[]) {
     return arguments;
 }
 
+/* ******************************************************
+ * Purpose: Parses --name=value and --flag options
+ * ******************************************************
+ * Parameters:
+ *   argc: Number of arguments
+ *   argv: Char* array of arguments
+ * ******************************************************
+*/
+map<string, string> parseOptions(int argc, char* argv[]) {
+    map<string, string> options = map<string, string>();
+    for (int argIndex = 1; argIndex < argc; argIndex++) {
+        string arg = argv[argIndex];
+        if (arg.rfind("--", 0) != 0) {
+            continue;
+        }
+        size_t equalsIndex = arg.find("=");
+        if (equalsIndex == string::npos) {
+            options[arg.substr(2)] = "";
+        } else {
+            options[arg.substr(2, equalsIndex - 2)] = arg.substr(equalsIndex + 1);
+        }
+    }
+    return options;
+}
+
 /* ******************************************************
  * Purpose: Checks for tid and frame argument validity
  * ******************************************************
  * Parameters:
  *   args: Vector [TID start, TID end, Frame amount]
+ *   maxAdvance: last advance with a TID and SID
  * ******************************************************
 */
-void handleArguments(vector<int> &args) {
+void handleArguments(vector<int> &args, int maxAdvance) {
     if (args[0] < 0) {
         cout << "TID lower bound exceeded, set to 0." << endl;
         args[0] = 0;
     }
-    if (args[0] > 100000) {
-        cout << "TID upper bound exceeded, set to 100000." << endl;
-        args[0] = 100000;
+    if (args[0] > maxAdvance) {
+        cout << "TID upper bound exceeded, set to " << maxAdvance << "." << endl;
+        args[0] = maxAdvance;
     }
     if (args[1] < args[0]) {
         cout << "TID range error, upper bound set to lower bound." << endl;
         args[1] = args[0];
     }
-    if (args[1] > 100000) {
-        cout << "TID upper bound exceeded, set to 100000." << endl;
-        args[1] = 100000;
+    if (args[1] > maxAdvance) {
+        cout << "TID upper bound exceeded, set to " << maxAdvance << "." << endl;
+        args[1] = maxAdvance;
     }
     if (args[2] < 1) {
         cout << "Frame lower bound exceeded, set to 1." << endl;
         args[2] = 1;
     }
-    if (args[2] > 100000) {
-        cout << "Frame upper bound exceeded, set to 100000." << endl;
-        args[2] = 100000;
+    if (args[2] > maxAdvance) {
+        cout << "Frame upper bound exceeded, set to " << maxAdvance << "." << endl;
+        args[2] = maxAdvance;
     }
     if (args[3] < 1) {
         cout << "Thread count lower bound exceeded, set to 1." << endl;
@@ -187,11 +952,12 @@ map<string, vector<long long>> dataFileToMap(string fileName, vector<string> &en
         vector<long long> enemyDataVector = vector<long long>();
         
         long long pieceOne = hexStringToIntLittleEndian(enemyData.substr(0, 8));
+        long long pieceThree = hexStringToIntLittleEndian(enemyData.substr(8, 8));
+        enemyDataVector.reserve(13);
         enemyDataVector.push_back(pieceOne);
         for (int i = 0; i < 12; i++) {
             int pieceTwoStart = (i + 8) * 8;
             long long pieceTwo = hexStringToIntLittleEndian(enemyData.substr(pieceTwoStart, 8));
-            long long pieceThree = hexStringToIntLittleEndian(enemyData.substr(8 , 8));
             enemyDataVector.push_back(pieceTwo ^ pieceOne ^ pieceThree);
         }
         enemyDict.insert(pair<string, vector<long long>>(enemyMon, enemyDataVector));
@@ -237,24 +1003,35 @@ map<string, vector<int>> dataOrderToMap(string fileName) {
  * ******************************************************
 */
 long long hexStringToIntLittleEndian(string hexString) {
-    string reversedHexString = "";
-    for (int i = 0; i * 2 < hexString.length(); i++) {
-        reversedHexString = hexString.substr(i * 2, 2) + reversedHexString;
+    // Byte pairs are read in place, the last pair being the most significant
+    long long value = 0;
+    for (int i = (int)hexString.length() - 2; i >= 0; i -= 2) {
+        for (int digitIndex = i; digitIndex < i + 2; digitIndex++) {
+            char digit = hexString[digitIndex];
+            int nibble = digit >= '0' && digit <= '9' ? digit - '0'
+                : digit >= 'a' && digit <= 'f' ? digit - 'a' + 10
+                : digit >= 'A' && digit <= 'F' ? digit - 'A' + 10 : -1;
+            if (nibble < 0) {
+                throw invalid_argument("hexStringToIntLittleEndian: " + hexString);
+            }
+            value = (value << 4) | nibble;
+        }
     }
-    return stoll(reversedHexString, 0, 16);
+    return value;
 }
 
 /* ******************************************************
- * Purpose: Parses Otid file into a 2d array
+ * Purpose: Parses Otid file into TID and SID arrays
+ *   indexed by advance
  * ******************************************************
  * Parameters:
- *   fileName: Hex string to convert
+ *   fileName: Name of file containing otid data
  * ******************************************************
 */
-vector<vector<int>> otidFileToVector(string fileName) {
+OtidTable otidFileToTable(string fileName) {
     string otidDataRawLine = "";
     ifstream otidDataFile(fileName);
-    vector<vector<int>> otidVector = vector<vector<int>>();
+    OtidTable otidTable = OtidTable();
     const string DELIMITER = ",";
     bool headerRow = true;
 
@@ -264,25 +1041,22 @@ vector<vector<int>> otidFileToVector(string fileName) {
             continue;
         }
 
-        int firstCommaIndex = otidDataRawLine.find(DELIMITER);
-        int secondCommaIndex = otidDataRawLine.find(DELIMITER, firstCommaIndex + 1);
-        int thirdCommaIndex = otidDataRawLine.find(DELIMITER, secondCommaIndex + 1);
-        string advancesString = otidDataRawLine.substr(0, firstCommaIndex);
-        string tidString = otidDataRawLine.substr(firstCommaIndex + 1, secondCommaIndex);
-        string sidString = otidDataRawLine.substr(secondCommaIndex + 1, thirdCommaIndex);
-        vector<int> otidRow = vector<int>();
-        
-        otidRow.push_back(stoi(advancesString));
-        otidRow.push_back(stoi(tidString));
-        otidRow.push_back(stoi(sidString));
-
-        otidVector.push_back(otidRow);
+        // TID and SID are parsed in place after the first and second commas
+        size_t firstCommaIndex = otidDataRawLine.find(DELIMITER);
+        size_t secondCommaIndex = otidDataRawLine.find(DELIMITER, firstCommaIndex + 1);
+        if (firstCommaIndex == string::npos || secondCommaIndex == string::npos) {
+            continue;
+        }
+        otidTable.tids.push_back(strtol(otidDataRawLine.c_str() + firstCommaIndex + 1, nullptr, 10));
+        otidTable.sids.push_back(strtol(otidDataRawLine.c_str() + secondCommaIndex + 1, nullptr, 10));
     }
-    return otidVector;
+    return otidTable;
 }
 
 /* ******************************************************
- * Purpose: Organizes threads to calculate checksums
+ * Purpose: Organizes threads to calculate checksums.
+ *   The TID x frame space is split into tiles so a few
+ *   TIDs with many frames still use every thread.
  * ******************************************************
  * Parameters:
  *   arguments: Arguments from command line
@@ -290,153 +1064,524 @@ vector<vector<int>> otidFileToVector(string fileName) {
  *     [1] : TID End
  *     [2] : Frames to calculate
  *     [3] : Number of threads
- *   dataOrder: idk what this is
- *   enemyList: vector of enemy mons
- *   enemyDict: map of enemy mon to enemy data
- *   otidVector: vector of otid data
+ *   tileFrames: max frames per task
+ *   context: shared tables for the run
+ *   matchBinaryPath: binary match file to write
+ *   manifest: run parameters and the tiles already in
+ *     the binary file
+ *   manifestPath: manifest to checkpoint to
+ *   shardIndex: 0 based shard of the run to calc
+ *   shardCount: number of shards the run is split into
+ *   metrics: counters of the run
+ *   progressSeconds: time between progress lines
+ * ******************************************************
+ * Output: Match records in TID, frame, mon order
  * ******************************************************
 */
-void calculateChecksums(vector<int> arguments, const string dataOrder[], map<string, vector<int>> dataOrderOrder, vector<string> enemyList, map<string, vector<long long>> enemyDict, vector<vector<int>> otidVector) {
+void calculateChecksums(vector<int> arguments, int tileFrames, const RunContext &context, string matchBinaryPath, RunManifest manifest, string manifestPath, int shardIndex, int shardCount, RunMetrics &metrics, double progressSeconds) {
     // Calculate Checksums
-    cout << "Executing with TIDs " << arguments[0] << " to " << arguments[1] << " (inclusive) and the first " << arguments[2] << " frames" << " using " << arguments[3] << " threads." << endl;
-    ThreadPool pool(arguments[3]);
-    for (int tid = arguments[0]; tid <= arguments[1]; tid++) {
-        pool.enqueue([=, &enemyList, &enemyDict, &otidVector]() {
-            calculateChecksumMatchesThread(tid, arguments[2], dataOrder, ref(dataOrderOrder), ref(enemyList), ref(enemyDict), ref(otidVector));
+    cout << "Executing with TIDs " << arguments[0] << " to " << arguments[1] << " (inclusive) and the first " << arguments[2] << " frames" << " using " << arguments[3] << " threads and the " << checksumKernelName(context.engine.kernel()) << " kernel." << endl;
+    vector<SweepTile> tiles = shardSweepTiles(buildSweepTiles(arguments[0], arguments[1], 0, arguments[2], tileFrames), shardIndex, shardCount);
+    if (shardCount > 1) {
+        cout << "Shard " << shardIndex + 1 << " of " << shardCount << " has " << tiles.size() << " tiles." << endl;
+    }
+
+    size_t firstTile = manifest.committedTiles < tiles.size() ? manifest.committedTiles : tiles.size();
+    uint64_t candidates = 0;
+    for (size_t tileIndex = firstTile; tileIndex < tiles.size(); tileIndex++) {
+        candidates += (uint64_t)(tiles[tileIndex].frameEnd - tiles[tileIndex].frameStart) * context.monTable.monCount;
+    }
+
+    // Tiles are written in order, so the manifest only needs the count written so far
+    writeRunManifest(manifestPath, manifest);
+    ResultSink sink(matchBinaryPath, "", matchFileHeaderBytes(context.monTable.monCount, context.pid), "", ios::binary, tiles.size(), MAX_BUFFERED_OUTPUT,
+        firstTile, [manifest, manifestPath](size_t tilesWritten, uint64_t matchBytes) mutable {
+            manifest.committedTiles = tilesWritten;
+            manifest.committedBytes = matchBytes;
+            writeRunManifest(manifestPath, manifest);
+        });
+    metrics.startProgress(tiles.size() - firstTile, candidates, milliseconds((long long)(progressSeconds * 1000)), [&sink]() {
+        return sink.bytesWritten();
+        });
+    steady_clock::time_point computeStart = steady_clock::now();
+    ThreadPool pool(arguments[3], context.workerCpus);
+    for (size_t tileIndex = firstTile; tileIndex < tiles.size(); tileIndex++) {
+        SweepTile tile = tiles[tileIndex];
+        pool.enqueue([tile, tileIndex, &context, &sink, &metrics]() {
+            ProfileScope scope("tile");
+            steady_clock::time_point tileStart = steady_clock::now();
+            TileOutput output = sink.acquire();
+            calculateChecksumMatchesThread(tile, context, context.engine, output);
+            countTileMetrics(tile, context.monTable.monCount, output, steady_clock::now() - tileStart, metrics.local());
+            sink.submit(tileIndex, move(output));
             });
     }
 
-    // Wait for all threads to finish.
-    pool.stopAndWait();
+    // Wait for all threads to finish and the last tile to be written.
+    {
+        ProfileScope scope("compute");
+        pool.stopAndWait();
+    }
+    steady_clock::time_point writeStart = steady_clock::now();
+    metrics.addPhase("compute", writeStart - computeStart);
+    {
+        ProfileScope scope("drainWriter");
+        sink.close();
+    }
+    metrics.stopProgress();
+    metrics.addPhase("write", steady_clock::now() - writeStart);
+    metrics.addPhase("writerBusy", duration_cast<steady_clock::duration>(duration<double>(sink.writeSeconds())));
 }
 
 /* ******************************************************
- * Purpose: Loops through TIDs and frames and calcs
- *   checksums for each combination.
+ * Purpose: Adds a finished tile to the calling worker's
+ *   counters
  * ******************************************************
  * Parameters:
- *   tid: TID to calc
- *   frames: num frames to calc
- *   dataOrder: idk what this is
- *   enemyList: vector of enemy mons
- *   enemyDict: map of enemy mon to enemy data
- *   otidVector: vector of otid data
+ *   tile: TID and frame range calculated
+ *   monCount: mons checked per frame
+ *   output: match records of the tile
+ *   elapsed: time spent calculating the tile
+ *   counters: calling worker's counters
  * ******************************************************
 */
-void calculateChecksumMatchesThread(int tid, int frames, const string dataOrder[], map<string, vector<int>> dataOrderOrder, vector<string> &enemyList, map<string, vector<long long>> enemyDict, vector<vector<int>> otidVector) {
+void countTileMetrics(SweepTile tile, int monCount, const TileOutput &output, steady_clock::duration elapsed, WorkerCounters &counters) {
+    uint64_t aces = 0;
+    for (size_t recordStart = 0; recordStart + sizeof(MatchRecord) <= output.matches.size(); recordStart += sizeof(MatchRecord)) {
+        aces += (output.matches[recordStart + offsetof(MatchRecord, flags)] & MATCH_FLAG_ACE) ? 1 : 0;
+    }
+    counters.tiles.fetch_add(1, memory_order_relaxed);
+    counters.candidates.fetch_add((uint64_t)(tile.frameEnd - tile.frameStart) * monCount, memory_order_relaxed);
+    counters.matches.fetch_add(output.matches.size() / sizeof(MatchRecord), memory_order_relaxed);
+    counters.aces.fetch_add(aces, memory_order_relaxed);
+    counters.computeNanos.fetch_add(duration_cast<nanoseconds>(elapsed).count(), memory_order_relaxed);
+}
 
-    // Delete output files if they exist and create a new one.
-	string matchFilePath = MATCH_FOLDER + "/" + to_string(tid) + ".csv";
-    string aceFilePath = ACE_FOLDER + "/" + to_string(tid) + ".csv";
-    try {
-        filesystem::remove(matchFilePath);
-        filesystem::remove(aceFilePath);
-    } catch (int errorCode) { }
-    ofstream matchFile(matchFilePath);
-    ofstream aceFile(aceFilePath);
-    int enemyListSize = enemyList.size();
-    int dataOrderStringLength = 4;
+/* ******************************************************
+ * Purpose: Sweeps the TID x frame space like
+ *   calculateChecksums but counts matches in per-thread
+ *   histograms instead of writing them, then merges the
+ *   histograms into one summary table.
+ * ******************************************************
+ * Parameters:
+ *   arguments: Arguments from command line
+ *   tileFrames: max frames per task
+ *   context: shared tables for the run
+ *   histogramPath: csv file for the summary
+ *   shardIndex: zero based shard to calculate
+ *   shardCount: number of shards
+ *   metrics: counters of the run
+ *   progressSeconds: time between progress lines
+ * ******************************************************
+*/
+void calculateAggregate(vector<int> arguments, int tileFrames, const RunContext &context, string histogramPath, int shardIndex, int shardCount, RunMetrics &metrics, double progressSeconds) {
+    cout << "Counting matches of TIDs " << arguments[0] << " to " << arguments[1] << " (inclusive) and the first " << arguments[2] << " frames" << " using " << arguments[3] << " threads and the " << checksumKernelName(context.engine.kernel()) << " kernel." << endl;
+    vector<SweepTile> tiles = shardSweepTiles(buildSweepTiles(arguments[0], arguments[1], 0, arguments[2], tileFrames), shardIndex, shardCount);
+    uint64_t candidates = 0;
+    for (const SweepTile &tile : tiles) {
+        candidates += (uint64_t)(tile.frameEnd - tile.frameStart) * context.monTable.monCount;
+    }
 
-    // Trainer ID is inclusive. We don't do subtraction in TID like in python bc we don't need to account for header row.
-    string playerHex = intToHex(otidVector[tid][2], 4) + intToHex(otidVector[tid][1], 4).substr(2);
-    long long playerLongLong = stoll(playerHex, 0, 16);
-    long long playerKey = PID ^ playerLongLong;
-
-    // Start at frame 0. Python version starts at 1 bc of header column
-    for (int frame = 0; frame < frames; frame++) {
-
-        string enemyHex = intToHex(otidVector[frame][1], 4) + intToHex(otidVector[frame][2], 4).substr(2);
-        long long enemyLongLong = stoll(enemyHex, 0, 16);
-        long long enemyKey = PID ^ enemyLongLong;
-        long long data[12] = {};
-
-        // Loop through all mons
-        for (int enemyListIndex = 0; enemyListIndex < enemyListSize; enemyListIndex++) {
-            string enemyMon = enemyList[enemyListIndex];
-            vector<long long> enemyMonData = enemyDict[enemyMon];
-            string dataOrderString = dataOrder[enemyMonData[0] % 24];
-            vector<int> usedDataOrder = dataOrderOrder[dataOrderString];
-
-            for (int dataOrderIndex = 0; dataOrderIndex < 12; dataOrderIndex++) {
-                data[dataOrderIndex] = enemyMonData[usedDataOrder[dataOrderIndex]];
-            }
+    MatchAggregator aggregator(context.monTable.monCount);
+    metrics.startProgress(tiles.size(), candidates, milliseconds((long long)(progressSeconds * 1000)), nullptr);
+    steady_clock::time_point computeStart = steady_clock::now();
+    ThreadPool pool(arguments[3], context.workerCpus);
+    for (const SweepTile &tile : tiles) {
+        pool.enqueue([tile, &context, &aggregator, &metrics]() {
+            ProfileScope scope("tile");
+            thread_local vector<EngineMatch> engineMatches = vector<EngineMatch>();
+            steady_clock::time_point tileStart = steady_clock::now();
+            MatchHistogram &histogram = aggregator.local();
+            uint64_t acesBefore = histogram.total.aces;
+            uint64_t matches = aggregateChecksumMatchesThread(tile, context, context.engine, histogram, engineMatches);
+
+            WorkerCounters &counters = metrics.local();
+            counters.tiles.fetch_add(1, memory_order_relaxed);
+            counters.candidates.fetch_add((uint64_t)(tile.frameEnd - tile.frameStart) * context.monTable.monCount, memory_order_relaxed);
+            counters.matches.fetch_add(matches, memory_order_relaxed);
+            counters.aces.fetch_add(histogram.total.aces - acesBefore, memory_order_relaxed);
+            counters.computeNanos.fetch_add(duration_cast<nanoseconds>(steady_clock::now() - tileStart).count(), memory_order_relaxed);
+            });
+    }
+    {
+        ProfileScope scope("compute");
+        pool.stopAndWait();
+    }
+    metrics.stopProgress();
+    steady_clock::time_point mergeStart = steady_clock::now();
+    metrics.addPhase("compute", mergeStart - computeStart);
 
-            // Loop through pokeballs. We quit as soon as we find a match, even though there are likely more of the same pokeball.
-            for (long long pokeballIndex = 1; pokeballIndex < 13; pokeballIndex++) {
-                long long data9Piece1 = data[9] & 0b10000111111111111111111111111111; // llToBin(data[9], 32).substr(2, 1) Get first bit
-                long long data9Piece2 = pokeballIndex << 27; // Shift bits over 27 to be next to Piece 1
-                data[9] = data9Piece1 + data9Piece2;
-                const string CSV_HEADER = "Player frame,Enemy Frame,Player TID/SID,Enemy TID/SID,Species,Held Item,Moves,Pokeball,Egg,Enemy Mon";
-                ChecksumMatchResults matchResults = calculateMatch(data, playerKey, enemyKey);
-                if (matchResults.match) {
-                    string matchOut = 
-                        to_string(tid) + "," +                                          // Player Frame
-                        to_string(frame) + "," +                                        // Enemy Frame
-                        to_string(otidVector[tid][1]) + " " +                           // Player TID
-                        to_string(otidVector[tid][2]) + "," +                           // Player SID
-                        to_string(otidVector[frame][2]) + " " +                         // Enemy TID
-                        to_string(otidVector[frame][1]) + "," +                         // Enemy SID
-                        "0x" + intToHex(matchResults.keyXorData0, 8).substr(6) + "," +  // Species
-                        intToHex(matchResults.keyXorData0, 8).substr(0, 6) + "," +      // Held Item
-                        "0x" + intToHex(matchResults.keyXorData3, 8).substr(6) + " " +  // Moves 1
-                        intToHex(matchResults.keyXorData3, 8).substr(0, 6) + " " +      // Moves 2
-                        "0x" + intToHex(matchResults.keyXorData4, 8).substr(6) + " " +  // Moves 3
-                        intToHex(matchResults.keyXorData4, 8).substr(0, 6) + "," +      // Moves 4
-                        to_string(pokeballIndex) + "," +                                // Pokeball
-                        llToBin(matchResults.keyXorData10, 32).substr(3, 1) + "," +     // Egg
-                        enemyMon;                                                       // Enemy Mon
-
-                    matchFile << matchOut << endl;
-
-                    if (matchResults.ace) {
-                        aceFile << matchOut << endl;
-                    }
-                    break;
+    MatchHistogram histogram = aggregator.merged();
+    writeHistogramCsv(histogramPath, histogram, context.enemyList);
+    metrics.addPhase("merge", steady_clock::now() - mergeStart);
+    cout << histogram.total.matches << " matches and " << histogram.total.aces << " aces counted, summary written to " << histogramPath << endl;
+}
+
+/* ******************************************************
+ * Purpose: Finds the earliest matches of every TID. TIDs
+ *   are swept in waves, and within a wave tiles go out in
+ *   frame order so early frames of every TID are checked
+ *   first. Once a TID's answer is full its bound lets the
+ *   workers skip or cut short its later tiles. Each
+ *   wave's answers are written in TID order when it ends.
+ * ******************************************************
+ * Parameters:
+ *   arguments: Arguments from command line
+ *   tileFrames: max frames per task
+ *   context: shared tables for the run
+ *   hitsPerTid: matches to keep per TID, or per TID and
+ *     mon when perMon is set
+ *   perMon: keep the earliest matches of every mon
+ *   matchPath: csv file for the answers
+ *   shardIndex: zero based shard to calculate
+ *   shardCount: number of shards
+ *   metrics: counters of the run
+ *   progressSeconds: time between progress lines
+ * ******************************************************
+*/
+void calculateEarliest(vector<int> arguments, int tileFrames, const RunContext &context, int hitsPerTid, bool perMon, string matchPath, int shardIndex, int shardCount, RunMetrics &metrics, double progressSeconds) {
+    // Shards split the TIDs, each TID's answer needs every frame
+    long long tidCount = (long long)arguments[1] - arguments[0] + 1;
+    int tidStart = arguments[0] + (int)(tidCount * shardIndex / shardCount);
+    int tidEnd = arguments[0] + (int)(tidCount * (shardIndex + 1) / shardCount) - 1;
+    cout << "Finding the first " << hitsPerTid << " match" << (hitsPerTid > 1 ? "es" : "") << (perMon ? " of each mon" : "") << " for TIDs " << tidStart << " to " << tidEnd << " (inclusive) in the first " << arguments[2] << " frames using " << arguments[3] << " threads and the " << checksumKernelName(context.engine.kernel()) << " kernel." << endl;
+
+    int monCount = context.monTable.monCount;
+    uint64_t tiles = 0;
+    uint64_t candidates = 0;
+    if (tidEnd >= tidStart) {
+        tiles = (uint64_t)(tidEnd - tidStart + 1) * ((arguments[2] + tileFrames - 1) / tileFrames);
+        candidates = (uint64_t)(tidEnd - tidStart + 1) * arguments[2] * monCount;
+    }
+    metrics.startProgress(tiles, candidates, milliseconds((long long)(progressSeconds * 1000)), nullptr);
+    steady_clock::time_point computeStart = steady_clock::now();
+
+    ofstream matchFile(matchPath, ios::out | ios::trunc | ios::binary);
+    matchFile << CSV_HEADER << "\n";
+    atomic<uint64_t> skippedTiles(0);
+    ThreadPool pool(arguments[3], context.workerCpus);
+    for (int waveStart = tidStart; waveStart <= tidEnd; waveStart += min(EARLIEST_WAVE_TIDS, tidEnd - waveStart + 1)) {
+        int waveEnd = waveStart + min(EARLIEST_WAVE_TIDS, tidEnd - waveStart + 1) - 1;
+        EarliestHits earliestHits(waveStart, waveEnd - waveStart + 1, hitsPerTid, perMon, monCount);
+        for (const SweepTile &waveTile : buildFrameMajorTiles(waveStart, waveEnd, 0, arguments[2], tileFrames)) {
+            pool.enqueue([waveTile, &context, &earliestHits, &skippedTiles, &metrics]() {
+                SweepTile tile = waveTile;
+                tile.frameEnd = min(tile.frameEnd, earliestHits.bound(tile.tid));
+                if (tile.frameEnd <= tile.frameStart) {
+                    skippedTiles.fetch_add(1, memory_order_relaxed);
+                    metrics.local().tiles.fetch_add(1, memory_order_relaxed);
+                    return;
                 }
+                ProfileScope scope("tile");
+                thread_local TileOutput output = TileOutput();
+                steady_clock::time_point tileStart = steady_clock::now();
+                output.matches.clear();
+                calculateChecksumMatchesThread(tile, context, context.engine, output);
+                vector<MatchRecord> records = vector<MatchRecord>(output.matches.size() / sizeof(MatchRecord));
+                memcpy(records.data(), output.matches.data(), records.size() * sizeof(MatchRecord));
+                earliestHits.add(tile.tid, records);
+                countTileMetrics(tile, context.monTable.monCount, output, steady_clock::now() - tileStart, metrics.local());
+                });
+        }
+        pool.wait();
+
+        ProfileScope scope("writeWave");
+        string out = "";
+        for (int tid = waveStart; tid <= waveEnd; tid++) {
+            for (const MatchRecord &record : earliestHits.hits(tid)) {
+                formatMatchCsv(record, context.otidTable, context.enemyList, out);
             }
         }
+        matchFile.write(out.data(), out.size());
+    }
+    {
+        ProfileScope scope("compute");
+        pool.stopAndWait();
     }
-    cout << "Finished tid " + to_string(tid) + "\n";
-
     matchFile.close();
-    aceFile.close();
+    metrics.stopProgress();
+    metrics.addPhase("compute", steady_clock::now() - computeStart);
+    cout << skippedTiles.load() << " of " << tiles << " tiles skipped, earliest matches written to " << matchPath << endl;
+}
+
+/* ******************************************************
+ * Purpose: Times a calibration sweep with a kernel,
+ *   thread count, tile size and blocking. Nothing is
+ *   written, only the fastest of a few repeats is kept.
+ * ******************************************************
+ * Parameters:
+ *   context: tables of the run, its engine is retuned
+ *   config: configuration to time
+ *   tidStart: first TID of the sweep
+ *   tidEnd: last TID of the sweep (inclusive)
+ *   frames: frames per TID
+ * ******************************************************
+ * Returns: TID, frame and mon combinations per second
+ * ******************************************************
+*/
+double measureTuneConfig(RunContext &context, const TuneConfig &config, int tidStart, int tidEnd, int frames) {
+    context.engine.setKernel(config.kernel);
+    context.engine.setBlocking(config.blockFrames, config.blockMons);
+    vector<SweepTile> tiles = buildSweepTiles(tidStart, tidEnd, 0, frames, config.tileFrames);
+    double bestSeconds = 0;
+    // Pinned like a run with this many threads under --pin or --numa
+    vector<int> workerCpus = context.workerCpus.empty() ? vector<int>() : spreadWorkerCpus(context.topology, config.threads);
+    ThreadPool pool(config.threads, workerCpus);
+    for (int repeat = 0; repeat < AUTOTUNE_REPEATS; repeat++) {
+        steady_clock::time_point sweepStart = steady_clock::now();
+        for (const SweepTile &tile : tiles) {
+            pool.enqueue([tile, &context]() {
+                thread_local TileOutput output = TileOutput();
+                output.matches.clear();
+                calculateChecksumMatchesThread(tile, context, context.engine, output);
+                });
+        }
+        pool.wait();
+        double seconds = duration<double>(steady_clock::now() - sweepStart).count();
+        bestSeconds = repeat == 0 ? seconds : min(bestSeconds, seconds);
+    }
+    pool.stopAndWait();
+    return (double)(tidEnd - tidStart + 1) * frames * context.monTable.monCount / max(bestSeconds, 1e-9);
+}
+
+/* ******************************************************
+ * Purpose: Tunes the kernel, thread count, tile size and
+ *   blocking on a short sweep of the real tables and
+ *   saves the fastest as the host's profile
+ * ******************************************************
+ * Parameters:
+ *   context: tables of the run, its engine is retuned
+ *   arguments: Arguments from command line, the sweep
+ *     starts at the first TID
+ *   host: the host being tuned
+ *   profilePath: profile file to write
+ * ******************************************************
+*/
+int runAutotune(RunContext &context, vector<int> arguments, const HostFingerprint &host, string profilePath) {
+    int tidStart = arguments[0];
+    int tidEnd = min(tidStart + AUTOTUNE_TIDS, (int)context.otidTable.tids.size()) - 1;
+    int frames = min(context.frames, AUTOTUNE_FRAMES);
+    cout << "Tuning on " << host.cpuModel << " (" << host.cores << " cores, " << host.cpus << " CPUs) with TIDs " << tidStart << " to " << tidEnd << " and " << frames << " frames" << endl;
+    TuneConfig best = autotuneSearch(host, frames, [&context, tidStart, tidEnd, frames](const TuneConfig &config) {
+        return measureTuneConfig(context, config, tidStart, tidEnd, frames);
+        });
+    writeTuneProfile(profilePath, host, best);
+    cout << "Fastest: " << checksumKernelName(best.kernel) << " kernel, " << best.threads << " threads, " << best.tileFrames << " frame tiles, blocks of "
+        << best.blockFrames << " frames and " << best.blockMons << " mons at " << fixed << setprecision(0) << best.pairsPerSecond << " pairs/s, saved to " << profilePath << endl;
+    return 0;
+}
+
+/* ******************************************************
+ * Purpose: Calculates only the TID, frame and mon blocks
+ *   missing from the result cache, adds them to the cache
+ *   and builds the run's binary match file from it. The
+ *   PID cancels out of every match, so the cache is not
+ *   keyed by it.
+ * ******************************************************
+ * Parameters:
+ *   arguments: Arguments from command line
+ *   tileFrames: max frames per task
+ *   context: shared tables for the run
+ *   matchBinaryPath: binary match file to write
+ *   cacheDirectory: directory holding the cache
+ *   otids: OTID source of the run
+ *   metrics: counters of the run
+ *   progressSeconds: time between progress lines
+ * ******************************************************
+*/
+void calculateCachedChecksums(vector<int> arguments, int tileFrames, const RunContext &context, string matchBinaryPath, string cacheDirectory, string otids, RunMetrics &metrics, double progressSeconds) {
+    filesystem::create_directories(cacheDirectory);
+    vector<string> monHashes = monRecordHashes(context.monTable);
+    vector<CacheSegment> segments = readCacheIndex(cacheDirectory);
+    vector<CacheDelta> deltas = planCacheDeltas(segments, monHashes, otids, arguments[0], arguments[1], arguments[2]);
+    if (deltas.empty()) {
+        cout << "Every match is already cached." << endl;
+    }
+    uint64_t deltaTiles = 0;
+    uint64_t candidates = 0;
+    for (const CacheDelta &delta : deltas) {
+        for (const SweepTile &tile : buildSweepTiles(delta.tidStart, delta.tidEnd, delta.frameStart, delta.frameEnd, tileFrames)) {
+            deltaTiles++;
+            candidates += (uint64_t)(tile.frameEnd - tile.frameStart) * delta.monIndexes.size();
+        }
+    }
+    metrics.startProgress(deltaTiles, candidates, milliseconds((long long)(progressSeconds * 1000)), nullptr);
+    steady_clock::time_point computeStart = steady_clock::now();
+
+    for (const CacheDelta &delta : deltas) {
+        cout << "Executing with TIDs " << delta.tidStart << " to " << delta.tidEnd << " (inclusive), frames " << delta.frameStart << " to " << delta.frameEnd - 1 << " and " << delta.monIndexes.size() << " uncached mons using " << arguments[3] << " threads and the " << checksumKernelName(context.engine.kernel()) << " kernel." << endl;
+        MonTable deltaTable = subMonTable(context.monTable, delta.monIndexes);
+        MatchEngine deltaEngine(deltaTable);
+        deltaEngine.setKernel(context.engine.kernel());
+
+        CacheSegment segment = { "", otids, delta.tidStart, delta.tidEnd, delta.frameStart, delta.frameEnd, vector<string>() };
+        for (int monIndex : delta.monIndexes) {
+            segment.monHashes.push_back(monHashes[monIndex]);
+        }
+        segment.fileName = cacheSegmentName(segment);
+        string segmentPath = cacheDirectory + "/" + segment.fileName;
+
+        // A segment only joins the index once its file is complete, so an interrupted run keeps every finished segment
+        vector<SweepTile> tiles = buildSweepTiles(delta.tidStart, delta.tidEnd, delta.frameStart, delta.frameEnd, tileFrames);
+        {
+            ResultSink sink(segmentPath + ".tmp", "", matchFileHeaderBytes(deltaTable.monCount, context.pid), "", ios::binary, tiles.size(), MAX_BUFFERED_OUTPUT);
+            ThreadPool pool(arguments[3], context.workerCpus);
+            for (size_t tileIndex = 0; tileIndex < tiles.size(); tileIndex++) {
+                SweepTile tile = tiles[tileIndex];
+                pool.enqueue([tile, tileIndex, &context, &deltaEngine, &sink, &metrics]() {
+                    ProfileScope scope("tile");
+                    steady_clock::time_point tileStart = steady_clock::now();
+                    TileOutput output = sink.acquire();
+                    calculateChecksumMatchesThread(tile, context, deltaEngine, output);
+                    countTileMetrics(tile, deltaEngine.monCount(), output, steady_clock::now() - tileStart, metrics.local());
+                    sink.submit(tileIndex, move(output));
+                    });
+            }
+            pool.stopAndWait();
+            sink.close();
+        }
+        filesystem::rename(segmentPath + ".tmp", segmentPath);
+        appendCacheIndex(cacheDirectory, segment);
+        segments.push_back(segment);
+    }
+
+    metrics.stopProgress();
+    steady_clock::time_point assembleStart = steady_clock::now();
+    metrics.addPhase("compute", assembleStart - computeStart);
+    assembleCachedMatches(cacheDirectory, segments, monHashes, otids, arguments[0], arguments[1], arguments[2], arguments[3], matchBinaryPath, matchFileHeaderBytes(context.monTable.monCount, context.pid));
+    metrics.addPhase("assemble", steady_clock::now() - assembleStart);
+}
+
+/* ******************************************************
+ * Purpose: Joins a TID's player key against the enemy
+ *   key of each frame in a tile
+ * ******************************************************
+ * Parameters:
+ *   tile: TID and frame range to calc
+ *   context: shared tables for the run
+ *   engine: checksum tables of the mons to calc
+ *   engineMatches: Outputs the frame, mon and pokeball
+ *     combinations whose checksums match
+ * ******************************************************
+ * Returns: the TID's player key
+ * ******************************************************
+*/
+long long findTileMatches(SweepTile tile, const RunContext &context, const MatchEngine &engine, vector<EngineMatch> &engineMatches) {
+    const OtidTable &otidTable = context.otidTable;
+    int tid = tile.tid;
+
+    // Trainer ID is inclusive. We don't do subtraction in TID like in python bc we don't need to account for header row.
+    long long playerKey = 0;
+    {
+        ProfileScope scope("playerKey");
+        string playerHex = intToHex(otidTable.sids[tid], 4) + intToHex(otidTable.tids[tid], 4).substr(2);
+        long long playerLongLong = stoll(playerHex, 0, 16);
+        playerKey = context.pid ^ playerLongLong;
+    }
+
+    // Only frame, mon and pokeball combinations whose checksums match come back from the engine
+    ProfileScope scope("findMatches");
+    if (context.filter.active) {
+        findFilteredMatches(engine, context.enemyKeyIndex, playerKey, tile.frameStart, tile.frameEnd, context.filter, engineMatches);
+    } else {
+        engine.findMatches(playerKey, context.localEnemyKeys(), tile.frameStart, tile.frameEnd, engineMatches);
+    }
+    return playerKey;
+}
+
+/* ******************************************************
+ * Purpose: Finds a tile's matches and packs every
+ *   matching mon into a binary match record.
+ * ******************************************************
+ * Parameters:
+ *   tile: TID and frame range to calc
+ *   context: shared tables for the run
+ *   engine: checksum tables of the mons to calc
+ *   output: Outputs match records of the tile
+ * ******************************************************
+*/
+void calculateChecksumMatchesThread(SweepTile tile, const RunContext &context, const MatchEngine &engine, TileOutput &output) {
+    const EnemyKeyIndex &enemyKeyIndex = context.enemyKeyIndex;
+    int tid = tile.tid;
+    vector<EngineMatch> engineMatches = vector<EngineMatch>();
+    long long playerKey = findTileMatches(tile, context, engine, engineMatches);
+
+    const MonTable &monTable = engine.monTable();
+    ProfileScope recordScope("records");
+    for (const EngineMatch &engineMatch : engineMatches) {
+        int frame = engineMatch.frame;
+        ChecksumMatchResults matchResults = calculateMatch(monTable.record(engineMatch.monIndex, engineMatch.pokeball), playerKey, enemyKeyIndex.keys[frame]);
+        if (matchResults.match) {
+            MatchRecord record = makeMatchRecord(tid, frame, monTable.record(engineMatch.monIndex, engineMatch.pokeball), playerKey ^ enemyKeyIndex.keys[frame]);
+            output.matches.append((const char*)&record, sizeof(record));
+        }
+    }
 }
 
 /* ******************************************************
- * Purpose: Calculates checksum based on data array and
+ * Purpose: Finds a tile's matches and only counts them
+ *   in the calling worker's histogram, nothing is
+ *   formatted or written.
+ * ******************************************************
+ * Parameters:
+ *   tile: TID and frame range to calc
+ *   context: shared tables for the run
+ *   engine: checksum tables of the mons to calc
+ *   histogram: calling worker's histogram
+ *   engineMatches: scratch buffer reused between tiles
+ * ******************************************************
+ * Returns: matches counted
+ * ******************************************************
+*/
+uint64_t aggregateChecksumMatchesThread(SweepTile tile, const RunContext &context, const MatchEngine &engine, MatchHistogram &histogram, vector<EngineMatch> &engineMatches) {
+    const EnemyKeyIndex &enemyKeyIndex = context.enemyKeyIndex;
+    engineMatches.clear();
+    long long playerKey = findTileMatches(tile, context, engine, engineMatches);
+
+    const MonTable &monTable = engine.monTable();
+    ProfileScope recordScope("histogram");
+    uint64_t matches = 0;
+    for (const EngineMatch &engineMatch : engineMatches) {
+        const MonRecord &monRecord = monTable.record(engineMatch.monIndex, engineMatch.pokeball);
+        long long enemyKey = enemyKeyIndex.keys[engineMatch.frame];
+        if (calculateMatch(monRecord, playerKey, enemyKey).match) {
+            addMatchToHistogram(histogram, makeMatchRecord(tile.tid, engineMatch.frame, monRecord, playerKey ^ enemyKey));
+            matches++;
+        }
+    }
+    return matches;
+}
+
+/* ******************************************************
+ * Purpose: Calculates checksum based on a mon record and
  *   player and enemy key
  * ******************************************************
  * Parameters:
- *   data: Array of enemy mon data
+ *   record: Mon and pokeball record with its original checksum
  *   playerKey: Player key
  *   enemyKey: Enemy key
  * ******************************************************
 */
-ChecksumMatchResults calculateMatch(long long data[], long long playerKey, long long enemyKey) {
-
-    long long originalChecksum = ((data[0] % 65536) + (data[0] / 65536) + (data[1] % 65536) + (data[1] / 65536) + (data[2] % 65536)
-        + (data[2] / 65536) + (data[3] % 65536) + (data[3] / 65536) + (data[4] % 65536) + (data[4] / 65536)
-        + (data[5] % 65536) + (data[5] / 65536) + (data[6] % 65536) + (data[6] / 65536) + (data[7] % 65536)
-        + (data[7] / 65536) + (data[8] % 65536) + (data[8] / 65536) + (data[9] % 65536) + (data[9] / 65536)
-        + (data[10] % 65536) + (data[10] / 65536) + (data[11] % 65536) + (data[11] / 65536)) % 65536;
+ChecksumMatchResults calculateMatch(const MonRecord &record, long long playerKey, long long enemyKey) {
 
     long long keysXored = playerKey ^ enemyKey;
 
-    long long newChecksum = (((keysXored ^ data[0]) % 65536) + ((keysXored ^ data[0]) / 65536) + ((keysXored ^ data[1]) % 65536) + ((keysXored ^ data[1]) / 65536) + ((keysXored ^ data[2]) % 65536)
-        + ((keysXored ^ data[2]) / 65536) + ((keysXored ^ data[3]) % 65536) + ((keysXored ^ data[3]) / 65536) + ((keysXored ^ data[4]) % 65536) + ((keysXored ^ data[4]) / 65536)
-        + ((keysXored ^ data[5]) % 65536) + ((keysXored ^ data[5]) / 65536) + ((keysXored ^ data[6]) % 65536) + ((keysXored ^ data[6]) / 65536) + ((keysXored ^ data[7]) % 65536)
-        + ((keysXored ^ data[7]) / 65536) + ((keysXored ^ data[8]) % 65536) + ((keysXored ^ data[8]) / 65536) + ((keysXored ^ data[9]) % 65536) + ((keysXored ^ data[9]) / 65536)
-        + ((keysXored ^ data[10]) % 65536) + ((keysXored ^ data[10]) / 65536) + ((keysXored ^ data[11]) % 65536) + ((keysXored ^ data[11]) / 65536)) % 65536;
+    long long newChecksum = 0;
+    for (int dataIndex = 0; dataIndex < 12; dataIndex++) {
+        long long keyXorData = keysXored ^ record.data[dataIndex];
+        newChecksum += (keyXorData % 65536) + (keyXorData / 65536);
+    }
+    newChecksum = newChecksum % 65536;
 
-    if (originalChecksum == newChecksum) {
-        bool ace = (((keysXored ^ data[0]) % 65536) == 39710);
+    if (record.checksum == newChecksum) {
+        bool ace = (((keysXored ^ record.data[0]) % 65536) == 39710);
         ChecksumMatchResults matchResults = {
-            true,                   // bool match;
-            ace,                    // bool ace;
-            keysXored ^ data[0],    // long long keyXorData0;
-            keysXored ^ data[3],    // long long keyXorData3;
-            keysXored ^ data[4],    // long long keyXorData4;
-            keysXored ^ data[10],   // long long keyXorData10;
+            true,                           // bool match;
+            ace,                            // bool ace;
+            keysXored ^ record.data[0],     // long long keyXorData0;
+            keysXored ^ record.data[3],     // long long keyXorData3;
+            keysXored ^ record.data[4],     // long long keyXorData4;
+            keysXored ^ record.data[10],    // long long keyXorData10;
         };
 
         return matchResults;
@@ -454,40 +1599,6 @@ ChecksumMatchResults calculateMatch(long long data[], long long playerKey, long
     }
 }
 
-/* ******************************************************
- * Purpose: Combines checksum files into one file
- * ******************************************************
-*/
-void combineChecksumFiles() {
-	// Combine all match files into one
-	ofstream combinedMatchFile("./combinedMatches.csv");
-    combinedMatchFile << CSV_HEADER << endl;
-	for (const auto& entry : filesystem::directory_iterator(MATCH_FOLDER)) {
-		if (entry.path().extension() == ".csv" && entry.path().filename() != "combined.csv") {
-			ifstream matchFile(entry.path());
-			string line;
-			while (getline(matchFile, line)) {
-                combinedMatchFile << line << endl;
-			}
-		}
-	}
-    combinedMatchFile.close();
-
-    // Combine all ace files into one
-    ofstream combinedAceFile("./combinedAces.csv");
-    combinedAceFile << CSV_HEADER << endl;
-    for (const auto& entry : filesystem::directory_iterator(ACE_FOLDER)) {
-        if (entry.path().extension() == ".csv" && entry.path().filename() != "combined.csv") {
-            ifstream aceFile(entry.path());
-            string line;
-            while (getline(aceFile, line)) {
-                combinedAceFile << line << endl;
-            }
-        }
-    }
-    combinedAceFile.close();
-}
-
 /* ******************************************************
  * Purpose: Replaces spaces in a number string with 0
  * ******************************************************
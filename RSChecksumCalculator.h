@@ -13,23 +13,77 @@
 #include <sstream>
 #include <thread>
 #include <mutex>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include "RSChecksumCalculator.h"
 #include "ThreadPool.h"
+#include "MonTable.h"
+#include "MatchEngine.h"
+#include "MatchFilter.h"
+#include "OtidTable.h"
+#include "RunContext.h"
+#include "SweepTile.h"
+#include "ResultSink.h"
+#include "MatchRecord.h"
+#include "MatchExport.h"
+#include "OtidGenerator.h"
+#include "RunManifest.h"
+#include "ResultCache.h"
+#include "QueryServer.h"
+#include "MatchMerge.h"
+#include "RunMetrics.h"
+#include "Profiler.h"
+#include "InputSnapshot.h"
+#include "MatchAggregate.h"
+#include "EarliestHits.h"
+#include "AutoTune.h"
+#include "MappedFile.h"
+#include "ResultStore.h"
 
 using namespace std;
 
 int main(int argc, char* argv[]);
+int buildInputSnapshot(map<string, string> &options);
+int runExport(int argc, char* argv[]);
+bool loadMatchFileOtids(map<string, string> &options, string matchBinaryPath, int threads, OtidTable &otidTable);
+bool loadAdvanceOtids(map<string, string> &options, int advances, int threads, OtidTable &otidTable);
+int runMerge(int argc, char* argv[]);
+int runQuery(int argc, char* argv[]);
+bool parseShard(string shard, int &shardIndex, int &shardCount);
+bool parseRange(string range, int &rangeStart, int &rangeEnd);
+vector<long long> parsePidList(string pidString);
+string pidFileName(string fileName, const vector<long long> &pids, size_t pidIndex);
 vector<int> parseArguments(int argc, char* argv[]);
-void handleArguments(vector<int> &args);
+map<string, string> parseOptions(int argc, char* argv[]);
+void handleArguments(vector<int> &args, int maxAdvance);
 map<string, vector<long long>> dataFileToMap(string fileName, vector<string> &enemyList);
 map<string, vector<int>> dataOrderToMap(string fileName);
 long long hexStringToIntLittleEndian(string hexString);
-vector<vector<int>> otidFileToVector(string fileName);
-void calculateChecksums(vector<int> arguments, const string dataOrder[], map<string, vector<int>> dataOrderOrder, vector<string> enemyList, map<string, vector<long long>> enemyDict, vector<vector<int>> otidVector);
-void calculateChecksumMatchesThread(int tid, int frames, const string dataOrder[], map<string, vector<int>> dataOrderOrder, vector<string> &enemyList, map<string, vector<long long>> enemyDict, vector<vector<int>> otidVector);
-struct ChecksumMatchResults;
-ChecksumMatchResults calculateMatch(long long data[], long long playerKey, long long enemyKey);
-void combineChecksumFiles();
+OtidTable otidFileToTable(string fileName);
+void calculateChecksums(vector<int> arguments, int tileFrames, const RunContext &context, string matchBinaryPath, RunManifest manifest, string manifestPath, int shardIndex, int shardCount, RunMetrics &metrics, double progressSeconds);
+void countTileMetrics(SweepTile tile, int monCount, const TileOutput &output, chrono::steady_clock::duration elapsed, WorkerCounters &counters);
+void calculateCachedChecksums(vector<int> arguments, int tileFrames, const RunContext &context, string matchBinaryPath, string cacheDirectory, string otids, RunMetrics &metrics, double progressSeconds);
+void calculateAggregate(vector<int> arguments, int tileFrames, const RunContext &context, string histogramPath, int shardIndex, int shardCount, RunMetrics &metrics, double progressSeconds);
+double measureTuneConfig(RunContext &context, const TuneConfig &config, int tidStart, int tidEnd, int frames);
+int runAutotune(RunContext &context, vector<int> arguments, const HostFingerprint &host, string profilePath);
+void calculateEarliest(vector<int> arguments, int tileFrames, const RunContext &context, int hitsPerTid, bool perMon, string matchPath, int shardIndex, int shardCount, RunMetrics &metrics, double progressSeconds);
+long long findTileMatches(SweepTile tile, const RunContext &context, const MatchEngine &engine, vector<EngineMatch> &engineMatches);
+void calculateChecksumMatchesThread(SweepTile tile, const RunContext &context, const MatchEngine &engine, TileOutput &output);
+uint64_t aggregateChecksumMatchesThread(SweepTile tile, const RunContext &context, const MatchEngine &engine, MatchHistogram &histogram, vector<EngineMatch> &engineMatches);
+struct ChecksumMatchResults {
+    bool match;
+    bool ace;
+    long long keyXorData0;
+    long long keyXorData3;
+    long long keyXorData4;
+    long long keyXorData10;
+};
+ChecksumMatchResults calculateMatch(const MonRecord &record, long long playerKey, long long enemyKey);
 string padStringNumber(string number);
 template< typename T >
 string intToHex(T i, int len);
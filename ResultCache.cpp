@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "MatchMerge.h"
+#include "MatchRecord.h"
+#include "MonTable.h"
+#include "ResultCache.h"
+#include "ResultSink.h"
+#include "RunManifest.h"
+#include "ThreadPool.h"
+using namespace std;
+
+const string CACHE_INDEX_FILE = "index.csv";
+const int ASSEMBLY_BLOCK_TIDS = 256;
+const size_t MAX_BUFFERED_ASSEMBLY = 64 * 1024 * 1024;
+
+/* ******************************************************
+ * Purpose: Hashes each mon's compiled records, every
+ *   pokeball included. Cached results are keyed by this
+ *   hash, so they survive mons being added, removed or
+ *   reordered in enemyDataList.csv.
+ * ******************************************************
+ * Parameters:
+ *   monTable: compiled mon records
+ * ******************************************************
+*/
+vector<string> monRecordHashes(const MonTable &monTable) {
+    vector<string> monHashes = vector<string>();
+    for (int monIndex = 0; monIndex < monTable.monCount; monIndex++) {
+        string monBytes = "";
+        for (int pokeball = 1; pokeball <= 12; pokeball++) {
+            const MonRecord &record = monTable.record(monIndex, pokeball);
+            monBytes.append((const char*)record.data, sizeof(record.data));
+            monBytes.append((const char*)&record.checksum, sizeof(record.checksum));
+        }
+        monHashes.push_back(hashBytes(monBytes));
+    }
+    return monHashes;
+}
+
+/* ******************************************************
+ * Purpose: Copies some mons of a table into a new table
+ * ******************************************************
+ * Parameters:
+ *   monTable: compiled mon records
+ *   monIndexes: mons to copy, in their new order
+ * ******************************************************
+*/
+MonTable subMonTable(const MonTable &monTable, const vector<int> &monIndexes) {
+    MonTable subTable = MonTable();
+    subTable.monCount = monIndexes.size();
+    for (size_t subIndex = 0; subIndex < monIndexes.size(); subIndex++) {
+        for (int pokeball = 1; pokeball <= 12; pokeball++) {
+            MonRecord record = monTable.record(monIndexes[subIndex], pokeball);
+            record.monIndex = subIndex;
+            subTable.records.push_back(record);
+        }
+    }
+    return subTable;
+}
+
+/* ******************************************************
+ * Purpose: Reads the cache index. Each line is a segment:
+ *   file,otids,tidStart,tidEnd,frameStart,frameEnd,
+ *   monHash;monHash;...
+ * ******************************************************
+ * Parameters:
+ *   cacheDirectory: directory holding the cache
+ * ******************************************************
+*/
+vector<CacheSegment> readCacheIndex(string cacheDirectory) {
+    vector<CacheSegment> segments = vector<CacheSegment>();
+    ifstream indexFile(cacheDirectory + "/" + CACHE_INDEX_FILE);
+    string indexLine = "";
+    const string DELIMITER = ",";
+
+    while (getline(indexFile, indexLine)) {
+        vector<string> fields = vector<string>();
+        size_t fieldStart = 0;
+        for (int fieldIndex = 0; fieldIndex < 6; fieldIndex++) {
+            size_t fieldEnd = indexLine.find(DELIMITER, fieldStart);
+            if (fieldEnd == string::npos) {
+                break;
+            }
+            fields.push_back(indexLine.substr(fieldStart, fieldEnd - fieldStart));
+            fieldStart = fieldEnd + 1;
+        }
+        if (fields.size() != 6 || !filesystem::exists(cacheDirectory + "/" + fields[0])) {
+            continue;
+        }
+
+        CacheSegment segment = { fields[0], fields[1], stoi(fields[2]), stoi(fields[3]), stoi(fields[4]), stoi(fields[5]), vector<string>() };
+        string monHashList = indexLine.substr(fieldStart);
+        size_t hashStart = 0;
+        while (hashStart < monHashList.length()) {
+            size_t hashEnd = monHashList.find(";", hashStart);
+            if (hashEnd == string::npos) {
+                hashEnd = monHashList.length();
+            }
+            segment.monHashes.push_back(monHashList.substr(hashStart, hashEnd - hashStart));
+            hashStart = hashEnd + 1;
+        }
+        segments.push_back(segment);
+    }
+    return segments;
+}
+
+/* ******************************************************
+ * Purpose: Adds a finished segment to the cache index
+ * ******************************************************
+ * Parameters:
+ *   cacheDirectory: directory holding the cache
+ *   segment: segment whose file is complete
+ * ******************************************************
+*/
+void appendCacheIndex(string cacheDirectory, const CacheSegment &segment) {
+    ofstream indexFile(cacheDirectory + "/" + CACHE_INDEX_FILE, ios::out | ios::app);
+    string indexLine = segment.fileName + "," + segment.otids + "," + to_string(segment.tidStart) + "," + to_string(segment.tidEnd) + ","
+        + to_string(segment.frameStart) + "," + to_string(segment.frameEnd) + ",";
+    for (size_t hashIndex = 0; hashIndex < segment.monHashes.size(); hashIndex++) {
+        indexLine += (hashIndex > 0 ? ";" : "") + segment.monHashes[hashIndex];
+    }
+    indexFile << indexLine << '\n';
+}
+
+/* ******************************************************
+ * Purpose: Names a segment file after its contents
+ * ******************************************************
+ * Parameters:
+ *   segment: segment to name
+ * ******************************************************
+*/
+string cacheSegmentName(const CacheSegment &segment) {
+    string key = segment.otids + "," + to_string(segment.tidStart) + "," + to_string(segment.tidEnd) + ","
+        + to_string(segment.frameStart) + "," + to_string(segment.frameEnd);
+    for (const string &monHash : segment.monHashes) {
+        key += ";" + monHash;
+    }
+    return hashBytes(key) + ".bin";
+}
+
+/* ******************************************************
+ * Purpose: Works out which TID, frame and mon blocks of a
+ *   run are not in the cache yet.
+ *   Runs always start at frame 0 and deltas continue from
+ *   the cached frames, so the cached frames of a mon and
+ *   TID are always a prefix. The TID range is cut where
+ *   any segment starts or ends, and within each piece the
+ *   mons are grouped by how many frames they have cached.
+ * ******************************************************
+ * Parameters:
+ *   segments: cached segments
+ *   monHashes: hash of each mon of the run
+ *   otids: OTID source of the run
+ *   tidStart: first TID (inclusive)
+ *   tidEnd: last TID (inclusive)
+ *   frames: num frames to calc
+ * ******************************************************
+*/
+vector<CacheDelta> planCacheDeltas(const vector<CacheSegment> &segments, const vector<string> &monHashes, string otids, int tidStart, int tidEnd, int frames) {
+    vector<const CacheSegment*> usableSegments = vector<const CacheSegment*>();
+    vector<unordered_set<string>> segmentHashes = vector<unordered_set<string>>();
+    vector<int> breakpoints = { tidStart, tidEnd + 1 };
+    for (const CacheSegment &segment : segments) {
+        if (segment.otids != otids || segment.tidEnd < tidStart || segment.tidStart > tidEnd) {
+            continue;
+        }
+        usableSegments.push_back(&segment);
+        segmentHashes.push_back(unordered_set<string>(segment.monHashes.begin(), segment.monHashes.end()));
+        if (segment.tidStart > tidStart) {
+            breakpoints.push_back(segment.tidStart);
+        }
+        if (segment.tidEnd < tidEnd) {
+            breakpoints.push_back(segment.tidEnd + 1);
+        }
+    }
+    sort(breakpoints.begin(), breakpoints.end());
+    breakpoints.erase(unique(breakpoints.begin(), breakpoints.end()), breakpoints.end());
+
+    vector<CacheDelta> deltas = vector<CacheDelta>();
+    for (size_t pieceIndex = 0; pieceIndex + 1 < breakpoints.size(); pieceIndex++) {
+        int pieceStart = breakpoints[pieceIndex];
+        int pieceEnd = breakpoints[pieceIndex + 1] - 1;
+
+        // Follow the chain of segments covering each mon from frame 0
+        map<int, vector<int>> monsByCachedFrames = map<int, vector<int>>();
+        for (size_t monIndex = 0; monIndex < monHashes.size(); monIndex++) {
+            int cachedFrames = 0;
+            bool extended = true;
+            while (extended && cachedFrames < frames) {
+                extended = false;
+                for (size_t segmentIndex = 0; segmentIndex < usableSegments.size(); segmentIndex++) {
+                    const CacheSegment &segment = *usableSegments[segmentIndex];
+                    if (segment.tidStart <= pieceStart && segment.tidEnd >= pieceEnd && segment.frameStart <= cachedFrames
+                        && segment.frameEnd > cachedFrames && segmentHashes[segmentIndex].count(monHashes[monIndex])) {
+                        cachedFrames = segment.frameEnd;
+                        extended = true;
+                    }
+                }
+            }
+            if (cachedFrames < frames) {
+                monsByCachedFrames[cachedFrames].push_back(monIndex);
+            }
+        }
+
+        // Extend a delta of the previous piece when the same mons are missing the same frames
+        for (const pair<const int, vector<int>> &missing : monsByCachedFrames) {
+            bool merged = false;
+            for (CacheDelta &delta : deltas) {
+                if (delta.tidEnd == pieceStart - 1 && delta.frameStart == missing.first && delta.monIndexes == missing.second) {
+                    delta.tidEnd = pieceEnd;
+                    merged = true;
+                    break;
+                }
+            }
+            if (!merged) {
+                deltas.push_back({ pieceStart, pieceEnd, missing.first, frames, missing.second });
+            }
+        }
+    }
+    return deltas;
+}
+
+/* ******************************************************
+ * Purpose: Builds a run's binary match file from cached
+ *   segments. Blocks of TIDs are gathered in parallel,
+ *   with segment mons mapped to the run's mon order, and
+ *   written in TID, frame, mon order.
+ * ******************************************************
+ * Parameters:
+ *   cacheDirectory: directory holding the cache
+ *   segments: cached segments covering the run
+ *   monHashes: hash of each mon of the run
+ *   otids: OTID source of the run
+ *   tidStart: first TID (inclusive)
+ *   tidEnd: last TID (inclusive)
+ *   frames: num frames to calc
+ *   threads: number of threads
+ *   matchBinaryPath: binary match file to write
+ *   matchHeader: header of the binary match file
+ * ******************************************************
+*/
+void assembleCachedMatches(string cacheDirectory, const vector<CacheSegment> &segments, const vector<string> &monHashes, string otids, int tidStart, int tidEnd, int frames, int threads, string matchBinaryPath, string matchHeader) {
+    unordered_map<string, vector<uint16_t>> runMonsByHash = unordered_map<string, vector<uint16_t>>();
+    for (size_t monIndex = 0; monIndex < monHashes.size(); monIndex++) {
+        runMonsByHash[monHashes[monIndex]].push_back(monIndex);
+    }
+
+    // Segment mon index to run mon indexes, a mon no longer in the run maps to none
+    vector<const CacheSegment*> usableSegments = vector<const CacheSegment*>();
+    vector<vector<vector<uint16_t>>> segmentRunMons = vector<vector<vector<uint16_t>>>();
+    for (const CacheSegment &segment : segments) {
+        if (segment.otids != otids || segment.tidEnd < tidStart || segment.tidStart > tidEnd || segment.frameStart >= frames) {
+            continue;
+        }
+        vector<vector<uint16_t>> runMons = vector<vector<uint16_t>>();
+        for (const string &monHash : segment.monHashes) {
+            runMons.push_back(runMonsByHash.count(monHash) ? runMonsByHash[monHash] : vector<uint16_t>());
+        }
+        usableSegments.push_back(&segment);
+        segmentRunMons.push_back(runMons);
+    }
+
+    size_t blockCount = (tidEnd - tidStart) / ASSEMBLY_BLOCK_TIDS + 1;
+    ResultSink sink(matchBinaryPath, "", matchHeader, "", ios::binary, blockCount, MAX_BUFFERED_ASSEMBLY);
+    ThreadPool pool(threads);
+    for (size_t blockIndex = 0; blockIndex < blockCount; blockIndex++) {
+        pool.enqueue([blockIndex, tidStart, tidEnd, frames, cacheDirectory, &usableSegments, &segmentRunMons, &sink]() {
+            int blockStart = tidStart + blockIndex * ASSEMBLY_BLOCK_TIDS;
+            int blockEnd = min(tidEnd, blockStart + ASSEMBLY_BLOCK_TIDS - 1);
+            vector<string> blockPaths = vector<string>();
+            vector<size_t> blockSegments = vector<size_t>();
+            for (size_t segmentIndex = 0; segmentIndex < usableSegments.size(); segmentIndex++) {
+                const CacheSegment &segment = *usableSegments[segmentIndex];
+                if (segment.tidEnd >= blockStart && segment.tidStart <= blockEnd) {
+                    blockPaths.push_back(cacheDirectory + "/" + segment.fileName);
+                    blockSegments.push_back(segmentIndex);
+                }
+            }
+            gatherMatchBlock(blockPaths, blockIndex, blockStart, blockEnd, [frames, &blockSegments, &segmentRunMons](size_t pathIndex, MatchRecord record, vector<MatchRecord> &blockRecords) {
+                const vector<vector<uint16_t>> &runMons = segmentRunMons[blockSegments[pathIndex]];
+                if ((int)record.frame >= frames || record.monIndex >= runMons.size()) {
+                    return;
+                }
+                for (uint16_t runMon : runMons[record.monIndex]) {
+                    record.monIndex = runMon;
+                    blockRecords.push_back(record);
+                }
+                }, sink);
+            });
+    }
+    pool.stopAndWait();
+    sink.close();
+}
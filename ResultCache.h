@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "MonTable.h"
+using namespace std;
+
+struct CacheSegment {
+    string fileName;
+    string otids;
+    int tidStart;
+    int tidEnd;
+    int frameStart;
+    int frameEnd;
+    vector<string> monHashes;
+};
+
+struct CacheDelta {
+    int tidStart;
+    int tidEnd;
+    int frameStart;
+    int frameEnd;
+    vector<int> monIndexes;
+};
+
+vector<string> monRecordHashes(const MonTable &monTable);
+MonTable subMonTable(const MonTable &monTable, const vector<int> &monIndexes);
+vector<CacheSegment> readCacheIndex(string cacheDirectory);
+void appendCacheIndex(string cacheDirectory, const CacheSegment &segment);
+string cacheSegmentName(const CacheSegment &segment);
+vector<CacheDelta> planCacheDeltas(const vector<CacheSegment> &segments, const vector<string> &monHashes, string otids, int tidStart, int tidEnd, int frames);
+void assembleCachedMatches(string cacheDirectory, const vector<CacheSegment> &segments, const vector<string> &monHashes, string otids, int tidStart, int tidEnd, int frames, int threads, string matchBinaryPath, string matchHeader);
@@ -0,0 +1,178 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "ResultSink.h"
+#include "Profiler.h"
+using namespace std;
+
+const chrono::seconds CHECKPOINT_INTERVAL = chrono::seconds(1);
+
+/* ******************************************************
+ * Purpose: Opens both combined outputs and starts the
+ *   writer thread. Tiles are written in tile index order
+ *   no matter which thread finishes them first, so the
+ *   written tiles are always a prefix of the run.
+ * ******************************************************
+ * Parameters:
+ *   matchFilePath: combined match file
+ *   aceFilePath: combined ace file, empty for none
+ *   matchHeader: bytes written first to the match file
+ *   aceHeader: bytes written first to the ace file
+ *   mode: extra open mode such as ios::binary
+ *   tileCount: number of tiles in the run
+ *   maxBufferedBytes: bytes held for later tiles before
+ *     workers wait for the writer
+ *   firstTile: tiles already in the files when resuming,
+ *     the files are appended to without headers
+ *   checkpoint: called from the writer with the tiles
+ *     written and the match file size once the files are
+ *     flushed, about once a second and after the last tile
+ * ******************************************************
+*/
+ResultSink::ResultSink(string matchFilePath, string aceFilePath, string matchHeader, string aceHeader, ios::openmode mode, size_t tileCount, size_t maxBufferedBytes, size_t firstTile, function<void(size_t, uint64_t)> checkpoint)
+    : tileCount_(tileCount), maxBufferedBytes_(maxBufferedBytes), nextTile_(firstTile), checkpoint_(checkpoint), lastCheckpoint_(chrono::steady_clock::now()) {
+    ios::openmode openMode = firstTile > 0 ? ios::out | ios::app | mode : ios::out | ios::trunc | mode;
+    matchFile_.open(matchFilePath, openMode);
+    if (firstTile == 0) {
+        matchFile_.write(matchHeader.data(), matchHeader.size());
+    }
+    if (!aceFilePath.empty()) {
+        aceFile_.open(aceFilePath, openMode);
+        if (firstTile == 0) {
+            aceFile_.write(aceHeader.data(), aceHeader.size());
+        }
+    }
+    writer_ = thread([this] {
+        writerLoop();
+        });
+}
+
+ResultSink::~ResultSink() {
+    close();
+}
+
+/* ******************************************************
+ * Purpose: Hands out an empty output buffer, reusing the
+ *   capacity of one the writer already finished with
+ * ******************************************************
+*/
+TileOutput ResultSink::acquire() {
+    unique_lock<mutex> lock(mutex_);
+    if (freeBuffers_.empty()) {
+        return TileOutput();
+    }
+    TileOutput output = move(freeBuffers_.back());
+    freeBuffers_.pop_back();
+    return output;
+}
+
+/* ******************************************************
+ * Purpose: Queues a finished tile for the writer. Blocks
+ *   while too much later output is buffered, except for
+ *   the tile the writer is waiting on.
+ * ******************************************************
+ * Parameters:
+ *   tileIndex: index of the tile in write order
+ *   output: rows of the tile
+ * ******************************************************
+*/
+void ResultSink::submit(size_t tileIndex, TileOutput output) {
+    size_t bytes = output.matches.size() + output.aces.size();
+    unique_lock<mutex> lock(mutex_);
+    space_cv_.wait(lock, [this, tileIndex] {
+        return tileIndex == nextTile_ || bufferedBytes_ < maxBufferedBytes_;
+        });
+    bufferedBytes_ += bytes;
+    pending_[tileIndex] = move(output);
+    if (tileIndex == nextTile_) {
+        ready_cv_.notify_one();
+    }
+}
+
+/* ******************************************************
+ * Purpose: Writes tiles in order as they become ready
+ * ******************************************************
+*/
+void ResultSink::writerLoop() {
+    unique_lock<mutex> lock(mutex_);
+    while (nextTile_ < tileCount_) {
+        ready_cv_.wait(lock, [this] {
+            return pending_.count(nextTile_) > 0;
+            });
+        TileOutput output = move(pending_[nextTile_]);
+        pending_.erase(nextTile_);
+        lock.unlock();
+
+        ProfileScope scope("writeTile");
+        chrono::steady_clock::time_point writeStart = chrono::steady_clock::now();
+        matchFile_.write(output.matches.data(), output.matches.size());
+        if (aceFile_.is_open()) {
+            aceFile_.write(output.aces.data(), output.aces.size());
+        }
+        size_t bytes = output.matches.size() + output.aces.size();
+        bytesWritten_.fetch_add(bytes, memory_order_relaxed);
+        writeNanos_.fetch_add(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - writeStart).count(), memory_order_relaxed);
+        output.matches.clear();
+        output.aces.clear();
+
+        lock.lock();
+        bufferedBytes_ -= bytes;
+        freeBuffers_.push_back(move(output));
+        nextTile_++;
+        space_cv_.notify_all();
+
+        if (checkpoint_ && (nextTile_ == tileCount_ || chrono::steady_clock::now() - lastCheckpoint_ >= CHECKPOINT_INTERVAL)) {
+            size_t tilesWritten = nextTile_;
+            lock.unlock();
+            matchFile_.flush();
+            if (aceFile_.is_open()) {
+                aceFile_.flush();
+            }
+            checkpoint_(tilesWritten, matchFile_.tellp());
+            lastCheckpoint_ = chrono::steady_clock::now();
+            lock.lock();
+        }
+    }
+}
+
+/* ******************************************************
+ * Purpose: Waits for every tile to be written and closes
+ *   both files
+ * ******************************************************
+*/
+void ResultSink::close() {
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    if (matchFile_.is_open()) {
+        matchFile_.close();
+    }
+    if (aceFile_.is_open()) {
+        aceFile_.close();
+    }
+}
+
+/* ******************************************************
+ * Purpose: Bytes of tile output written so far
+ * ******************************************************
+*/
+uint64_t ResultSink::bytesWritten() const {
+    return bytesWritten_.load(memory_order_relaxed);
+}
+
+/* ******************************************************
+ * Purpose: Time the writer has spent writing tiles
+ * ******************************************************
+*/
+double ResultSink::writeSeconds() const {
+    return writeNanos_.load(memory_order_relaxed) / 1e9;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+struct TileOutput {
+    string matches;
+    string aces;
+};
+
+class ResultSink {
+public:
+ResultSink(string matchFilePath, string aceFilePath, string matchHeader, string aceHeader, ios::openmode mode, size_t tileCount, size_t maxBufferedBytes,
+    size_t firstTile = 0, function<void(size_t, uint64_t)> checkpoint = nullptr);
+~ResultSink();
+TileOutput acquire();
+void submit(size_t tileIndex, TileOutput output);
+void close();
+uint64_t bytesWritten() const;
+double writeSeconds() const;
+
+private:
+void writerLoop();
+
+ofstream matchFile_;
+ofstream aceFile_;
+size_t tileCount_;
+size_t maxBufferedBytes_;
+size_t nextTile_ = 0;
+function<void(size_t, uint64_t)> checkpoint_;
+chrono::steady_clock::time_point lastCheckpoint_;
+size_t bufferedBytes_ = 0;
+atomic<uint64_t> bytesWritten_{ 0 };
+atomic<uint64_t> writeNanos_{ 0 };
+map<size_t, TileOutput> pending_;
+vector<TileOutput> freeBuffers_;
+mutex mutex_;
+condition_variable ready_cv_;
+condition_variable space_cv_;
+thread writer_;
+};
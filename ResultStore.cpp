@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ResultStore.h"
+#include "MappedFile.h"
+#include "MatchRecord.h"
+using namespace std;
+
+const char RESULT_STORE_MAGIC[4] = { 'R', 'S', 'C', 'S' };
+
+/* ******************************************************
+ * Purpose: Name of the store written next to a binary
+ *   match file
+ * ******************************************************
+*/
+string resultStorePath(string matchBinaryPath) {
+    return matchBinaryPath.substr(0, matchBinaryPath.rfind(".")) + ".store";
+}
+
+// Bytes of one entry of each section, in StoreSection order
+const size_t STORE_SECTION_BYTES[STORE_SECTION_COUNT] = { 4, 4, 2, 1, 1, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4 };
+
+// Records read from the match file at a time while building a store
+const uint64_t STORE_BUILD_CHUNK = 65536;
+
+/* ******************************************************
+ * Purpose: Entries of a section, one per record or, for
+ *   a sparse index, one per stride
+ * ******************************************************
+*/
+uint64_t storeSectionEntries(int storeSection, uint64_t recordCount, uint32_t indexStride) {
+    bool fenceSection = storeSection == STORE_TID_FENCES || storeSection == STORE_FRAME_FENCES || storeSection == STORE_MON_FENCES || storeSection == STORE_SPECIES_FENCES;
+    return fenceSection ? (recordCount + indexStride - 1) / indexStride : recordCount;
+}
+
+/* ******************************************************
+ * Purpose: Turns the count of each key into the position
+ *   its first row takes in key order, and fills the
+ *   sparse index from those ranges
+ * ******************************************************
+ * Parameters:
+ *   counts: rows of each key, Outputs the first position
+ *     of each key
+ *   fences: Outputs the key at every stride-th position
+ * ******************************************************
+*/
+void startStoreIndex(vector<uint32_t> &counts, uint32_t* fences) {
+    uint64_t position = 0;
+    for (size_t key = 0; key < counts.size(); key++) {
+        uint64_t end = position + counts[key];
+        for (uint64_t fence = (position + STORE_INDEX_STRIDE - 1) / STORE_INDEX_STRIDE; fence * STORE_INDEX_STRIDE < end; fence++) {
+            fences[fence] = key;
+        }
+        counts[key] = position;
+        position = end;
+    }
+}
+
+/* ******************************************************
+ * Purpose: Writes a binary match file as a columnar
+ *   store with sparse indexes on tid, frame, mon and
+ *   species. The match file is read twice in chunks, once
+ *   to count the rows of each key and once to write the
+ *   columns and place each row in key order, a counting
+ *   sort that keeps ties in tid, frame, mon order. The
+ *   store is written to a .tmp file and renamed, so a
+ *   reader never sees half of one.
+ * ******************************************************
+ * Parameters:
+ *   matchBinaryPath: binary match file, sorted by tid,
+ *     frame and mon
+ *   storePath: store file to write
+ * ******************************************************
+*/
+bool buildResultStore(string matchBinaryPath, string storePath) {
+    ifstream matchFile(matchBinaryPath, ios::binary);
+    MatchFileHeader matchHeader = MatchFileHeader();
+    uint64_t recordCount = 0;
+    if (!readMatchFileHeader(matchFile, matchHeader, recordCount) || recordCount > UINT32_MAX) {
+        return false;
+    }
+
+    vector<MatchRecord> chunk = vector<MatchRecord>();
+    vector<uint32_t> frameCounts = vector<uint32_t>();
+    vector<uint32_t> monCounts = vector<uint32_t>(matchHeader.monCount);
+    vector<uint32_t> speciesCounts = vector<uint32_t>(0x10000);
+    uint32_t maxAdvance = 0;
+    for (uint64_t row = 0; row < recordCount; row += chunk.size()) {
+        chunk.resize(min(STORE_BUILD_CHUNK, recordCount - row));
+        if (!matchFile.read((char*)chunk.data(), chunk.size() * sizeof(MatchRecord))) {
+            return false;
+        }
+        for (const MatchRecord &record : chunk) {
+            if (record.frame >= frameCounts.size()) {
+                frameCounts.resize(record.frame + 1);
+            }
+            if (record.monIndex >= monCounts.size()) {
+                monCounts.resize(record.monIndex + 1);
+            }
+            frameCounts[record.frame]++;
+            monCounts[record.monIndex]++;
+            speciesCounts[record.keyXorData0 & 0xFFFF]++;
+            maxAdvance = max(maxAdvance, max(record.tid, record.frame));
+        }
+    }
+
+    ResultStoreHeader header = ResultStoreHeader();
+    memcpy(header.magic, RESULT_STORE_MAGIC, sizeof(header.magic));
+    header.version = RESULT_STORE_VERSION;
+    header.recordCount = recordCount;
+    header.monCount = matchHeader.monCount;
+    header.indexStride = STORE_INDEX_STRIDE;
+    header.pid = matchHeader.pid;
+    header.advances = recordCount > 0 ? maxAdvance + 1 : 0;
+
+    // Each key's columns and indexes sit together, 8 byte aligned
+    StoreSection layout[STORE_SECTION_COUNT] = { STORE_TIDS, STORE_FRAMES, STORE_TID_FENCES, STORE_FRAME_ROWS, STORE_FRAME_FENCES,
+        STORE_MONS, STORE_MON_ROWS, STORE_MON_FENCES, STORE_SPECIES_ROWS, STORE_SPECIES_FENCES, STORE_POKEBALLS, STORE_FLAGS,
+        STORE_KEY_XOR_DATA0, STORE_KEY_XOR_DATA3, STORE_KEY_XOR_DATA4, STORE_KEY_XOR_DATA10 };
+    uint64_t storeSize = sizeof(header);
+    for (StoreSection storeSection : layout) {
+        storeSize += (8 - storeSize % 8) % 8;
+        header.sections[storeSection] = storeSize;
+        storeSize += storeSectionEntries(storeSection, recordCount, STORE_INDEX_STRIDE) * STORE_SECTION_BYTES[storeSection];
+    }
+
+    string temporaryPath = storePath + ".tmp";
+    {
+        ofstream storeFile(temporaryPath, ios::out | ios::trunc | ios::binary);
+        storeFile.write((const char*)&header, sizeof(header));
+        if (!storeFile) {
+            return false;
+        }
+    }
+    error_code error;
+    filesystem::resize_file(temporaryPath, storeSize, error);
+    MappedFile storeFile;
+    if (error || !storeFile.open(temporaryPath, true)) {
+        return false;
+    }
+    char* store = storeFile.writableData();
+    uint32_t* tids = (uint32_t*)(store + header.sections[STORE_TIDS]);
+    uint32_t* frames = (uint32_t*)(store + header.sections[STORE_FRAMES]);
+    uint16_t* mons = (uint16_t*)(store + header.sections[STORE_MONS]);
+    uint8_t* pokeballs = (uint8_t*)(store + header.sections[STORE_POKEBALLS]);
+    uint8_t* flags = (uint8_t*)(store + header.sections[STORE_FLAGS]);
+    uint32_t* keyXorData0 = (uint32_t*)(store + header.sections[STORE_KEY_XOR_DATA0]);
+    uint32_t* keyXorData3 = (uint32_t*)(store + header.sections[STORE_KEY_XOR_DATA3]);
+    uint32_t* keyXorData4 = (uint32_t*)(store + header.sections[STORE_KEY_XOR_DATA4]);
+    uint32_t* keyXorData10 = (uint32_t*)(store + header.sections[STORE_KEY_XOR_DATA10]);
+    uint32_t* tidFences = (uint32_t*)(store + header.sections[STORE_TID_FENCES]);
+    uint32_t* frameRows = (uint32_t*)(store + header.sections[STORE_FRAME_ROWS]);
+    uint32_t* monRows = (uint32_t*)(store + header.sections[STORE_MON_ROWS]);
+    uint32_t* speciesRows = (uint32_t*)(store + header.sections[STORE_SPECIES_ROWS]);
+    startStoreIndex(frameCounts, (uint32_t*)(store + header.sections[STORE_FRAME_FENCES]));
+    startStoreIndex(monCounts, (uint32_t*)(store + header.sections[STORE_MON_FENCES]));
+    startStoreIndex(speciesCounts, (uint32_t*)(store + header.sections[STORE_SPECIES_FENCES]));
+
+    matchFile.clear();
+    matchFile.seekg(sizeof(MatchFileHeader));
+    for (uint64_t row = 0; row < recordCount; row += chunk.size()) {
+        chunk.resize(min(STORE_BUILD_CHUNK, recordCount - row));
+        if (!matchFile.read((char*)chunk.data(), chunk.size() * sizeof(MatchRecord))) {
+            return false;
+        }
+        for (size_t chunkIndex = 0; chunkIndex < chunk.size(); chunkIndex++) {
+            const MatchRecord &record = chunk[chunkIndex];
+            uint32_t recordRow = row + chunkIndex;
+            tids[recordRow] = record.tid;
+            frames[recordRow] = record.frame;
+            mons[recordRow] = record.monIndex;
+            pokeballs[recordRow] = record.pokeball;
+            flags[recordRow] = record.flags;
+            keyXorData0[recordRow] = record.keyXorData0;
+            keyXorData3[recordRow] = record.keyXorData3;
+            keyXorData4[recordRow] = record.keyXorData4;
+            keyXorData10[recordRow] = record.keyXorData10;
+            if (recordRow % STORE_INDEX_STRIDE == 0) {
+                tidFences[recordRow / STORE_INDEX_STRIDE] = record.tid;
+            }
+            frameRows[frameCounts[record.frame]++] = recordRow;
+            monRows[monCounts[record.monIndex]++] = recordRow;
+            speciesRows[speciesCounts[record.keyXorData0 & 0xFFFF]++] = recordRow;
+        }
+    }
+    storeFile.close();
+    filesystem::rename(temporaryPath, storePath, error);
+    return !error;
+}
+
+ResultStore::ResultStore() : header_() {
+}
+
+/* ******************************************************
+ * Purpose: Maps a store and checks its header and that
+ *   every section lies inside the file
+ * ******************************************************
+ * Parameters:
+ *   storePath: store file
+ * ******************************************************
+*/
+bool ResultStore::open(string storePath) {
+    header_ = ResultStoreHeader();
+    if (!file_.open(storePath) || file_.size() < sizeof(header_)) {
+        file_.close();
+        return false;
+    }
+    memcpy(&header_, file_.data(), sizeof(header_));
+    if (memcmp(header_.magic, RESULT_STORE_MAGIC, sizeof(header_.magic)) != 0 || header_.version != RESULT_STORE_VERSION || header_.indexStride == 0) {
+        file_.close();
+        return false;
+    }
+    for (int storeSection = 0; storeSection < STORE_SECTION_COUNT; storeSection++) {
+        uint64_t count = storeSectionEntries(storeSection, header_.recordCount, header_.indexStride);
+        if (header_.sections[storeSection] + count * STORE_SECTION_BYTES[storeSection] > file_.size()) {
+            file_.close();
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t ResultStore::recordCount() const {
+    return header_.recordCount;
+}
+
+int ResultStore::monCount() const {
+    return header_.monCount;
+}
+
+long long ResultStore::pid() const {
+    return header_.pid;
+}
+
+/* ******************************************************
+ * Purpose: Advances of TID and SID data the store needs,
+ *   one past its largest TID or frame
+ * ******************************************************
+*/
+int ResultStore::advances() const {
+    return header_.advances;
+}
+
+template< typename T >
+const T* ResultStore::section(StoreSection storeSection) const {
+    return (const T*)(file_.data() + header_.sections[storeSection]);
+}
+
+/* ******************************************************
+ * Purpose: Gathers a row's columns back into a record
+ * ******************************************************
+*/
+MatchRecord ResultStore::record(uint64_t row) const {
+    MatchRecord record = MatchRecord();
+    record.tid = section<uint32_t>(STORE_TIDS)[row];
+    record.frame = section<uint32_t>(STORE_FRAMES)[row];
+    record.monIndex = section<uint16_t>(STORE_MONS)[row];
+    record.pokeball = section<uint8_t>(STORE_POKEBALLS)[row];
+    record.flags = section<uint8_t>(STORE_FLAGS)[row];
+    record.keyXorData0 = section<uint32_t>(STORE_KEY_XOR_DATA0)[row];
+    record.keyXorData3 = section<uint32_t>(STORE_KEY_XOR_DATA3)[row];
+    record.keyXorData4 = section<uint32_t>(STORE_KEY_XOR_DATA4)[row];
+    record.keyXorData10 = section<uint32_t>(STORE_KEY_XOR_DATA10)[row];
+    return record;
+}
+
+/* ******************************************************
+ * Purpose: Row at a position of a key's order
+ * ******************************************************
+*/
+uint64_t ResultStore::row(StoreKey storeKey, uint64_t position) const {
+    switch (storeKey) {
+    case STORE_KEY_FRAME:
+        return section<uint32_t>(STORE_FRAME_ROWS)[position];
+    case STORE_KEY_MON:
+        return section<uint32_t>(STORE_MON_ROWS)[position];
+    case STORE_KEY_SPECIES:
+        return section<uint32_t>(STORE_SPECIES_ROWS)[position];
+    default:
+        return position;
+    }
+}
+
+/* ******************************************************
+ * Purpose: Key at a position of the key's order
+ * ******************************************************
+*/
+uint32_t ResultStore::key(StoreKey storeKey, uint64_t position) const {
+    uint64_t keyRow = row(storeKey, position);
+    switch (storeKey) {
+    case STORE_KEY_FRAME:
+        return section<uint32_t>(STORE_FRAMES)[keyRow];
+    case STORE_KEY_MON:
+        return section<uint16_t>(STORE_MONS)[keyRow];
+    case STORE_KEY_SPECIES:
+        return section<uint32_t>(STORE_KEY_XOR_DATA0)[keyRow] & 0xFFFF;
+    default:
+        return section<uint32_t>(STORE_TIDS)[keyRow];
+    }
+}
+
+/* ******************************************************
+ * Purpose: First position of a key's order whose key is
+ *   at least value. The sparse index narrows the search
+ *   to one stride, so only that stride of the store is
+ *   touched.
+ * ******************************************************
+*/
+uint64_t ResultStore::lowerBound(StoreKey storeKey, uint64_t value) const {
+    StoreSection fenceSections[4] = { STORE_TID_FENCES, STORE_FRAME_FENCES, STORE_MON_FENCES, STORE_SPECIES_FENCES };
+    const uint32_t* fences = section<uint32_t>(fenceSections[storeKey]);
+    uint64_t fenceCount = (header_.recordCount + header_.indexStride - 1) / header_.indexStride;
+    uint64_t fence = lower_bound(fences, fences + fenceCount, value) - fences;
+    uint64_t low = fence > 0 ? (fence - 1) * header_.indexStride : 0;
+    uint64_t high = min(fence * header_.indexStride, header_.recordCount);
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        if (key(storeKey, middle) < value) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/* ******************************************************
+ * Purpose: Positions of a key's order holding a value
+ * ******************************************************
+ * Parameters:
+ *   storeKey: key to look up
+ *   value: key value
+ *   first: Outputs the first position
+ *   last: Outputs one past the last position
+ * ******************************************************
+*/
+void ResultStore::equalRange(StoreKey storeKey, uint32_t value, uint64_t &first, uint64_t &last) const {
+    first = lowerBound(storeKey, value);
+    last = lowerBound(storeKey, (uint64_t)value + 1);
+}
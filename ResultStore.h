@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "MatchRecord.h"
+using namespace std;
+
+enum StoreKey {
+    STORE_KEY_TID,
+    STORE_KEY_FRAME,
+    STORE_KEY_MON,
+    STORE_KEY_SPECIES
+};
+
+// Columns of every record in tid, frame, mon order, then for each key
+// the rows in key order (tid needs none, the columns are in tid order)
+// and a sparse index of the key at every STORE_INDEX_STRIDE-th position
+enum StoreSection {
+    STORE_TIDS,
+    STORE_FRAMES,
+    STORE_MONS,
+    STORE_POKEBALLS,
+    STORE_FLAGS,
+    STORE_KEY_XOR_DATA0,
+    STORE_KEY_XOR_DATA3,
+    STORE_KEY_XOR_DATA4,
+    STORE_KEY_XOR_DATA10,
+    STORE_TID_FENCES,
+    STORE_FRAME_ROWS,
+    STORE_FRAME_FENCES,
+    STORE_MON_ROWS,
+    STORE_MON_FENCES,
+    STORE_SPECIES_ROWS,
+    STORE_SPECIES_FENCES,
+    STORE_SECTION_COUNT
+};
+
+struct ResultStoreHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t recordCount;
+    uint32_t monCount;
+    uint32_t indexStride;
+    int64_t pid;
+    uint32_t advances;
+    uint32_t reserved;
+    uint64_t sections[STORE_SECTION_COUNT];
+};
+
+const uint32_t RESULT_STORE_VERSION = 1;
+const uint32_t STORE_INDEX_STRIDE = 1024;
+
+class ResultStore {
+public:
+ResultStore();
+bool open(string storePath);
+uint64_t recordCount() const;
+int monCount() const;
+long long pid() const;
+int advances() const;
+MatchRecord record(uint64_t row) const;
+uint32_t key(StoreKey storeKey, uint64_t position) const;
+uint64_t row(StoreKey storeKey, uint64_t position) const;
+void equalRange(StoreKey storeKey, uint32_t value, uint64_t &first, uint64_t &last) const;
+
+private:
+template< typename T >
+const T* section(StoreSection storeSection) const;
+uint64_t lowerBound(StoreKey storeKey, uint64_t value) const;
+
+MappedFile file_;
+ResultStoreHeader header_;
+};
+
+string resultStorePath(string matchBinaryPath);
+bool buildResultStore(string matchBinaryPath, string storePath);
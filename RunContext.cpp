@@ -0,0 +1,72 @@
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "NumaTopology.h"
+#include "RunContext.h"
+using namespace std;
+
+/* ******************************************************
+ * Purpose: Builds everything a run reads. Workers share
+ *   one RunContext by const reference, so nothing here is
+ *   copied per task.
+ * ******************************************************
+ * Parameters:
+ *   pid: PID used for both keys
+ *   frames: num frames to calc
+ *   filter: only matches passing this are written
+ *   kernel: checksum kernel to run
+ *   dataOrder: data order string for each PID % 24
+ *   dataOrderOrder: map of data order to word order
+ *   enemyList: vector of enemy mons, moved in
+ *   enemyDict: map of enemy mon to enemy data
+ *   otidTable: TID and SID per advance, moved in
+ * ******************************************************
+*/
+RunContext::RunContext(long long pid, int frames, MatchFilter filter, ChecksumKernel kernel, const string dataOrder[], map<string, vector<int>> &dataOrderOrder, vector<string> enemyList, map<string, vector<long long>> &enemyDict, OtidTable otidTable)
+    : pid(pid),
+    frames(frames),
+    filter(move(filter)),
+    enemyList(move(enemyList)),
+    otidTable(move(otidTable)),
+    monTable(compileMonTable(dataOrder, dataOrderOrder, this->enemyList, enemyDict)),
+    engine(monTable),
+    enemyKeyIndex(buildEnemyKeyIndex(this->otidTable, frames, pid)),
+    topology(readNumaTopology()) {
+    engine.setKernel(kernel);
+}
+
+/* ******************************************************
+ * Purpose: Gives each compute worker its own CPU, spread
+ *   across the NUMA nodes
+ * ******************************************************
+ * Parameters:
+ *   threads: number of compute workers
+ * ******************************************************
+*/
+void RunContext::pinWorkers(int threads) {
+    workerCpus = spreadWorkerCpus(topology, threads);
+}
+
+/* ******************************************************
+ * Purpose: Copies the tables the sweep streams, the half
+ *   sum tables and the enemy keys, onto every NUMA node
+ * ******************************************************
+*/
+void RunContext::placeOnNumaNodes() {
+    engine.placeOnNumaNodes(topology);
+    nodeEnemyKeys = vector<vector<long long>>(topology.nodeCpus.size());
+    for (size_t node = 0; node < topology.nodeCpus.size(); node++) {
+        runOnNumaNode(topology, node, [this, node]() {
+            nodeEnemyKeys[node] = enemyKeyIndex.keys;
+            });
+    }
+}
+
+/* ******************************************************
+ * Purpose: Enemy keys on the calling thread's NUMA node
+ * ******************************************************
+*/
+const vector<long long> &RunContext::localEnemyKeys() const {
+    return nodeEnemyKeys.empty() ? enemyKeyIndex.keys : nodeEnemyKeys[currentNumaNode(topology)];
+}
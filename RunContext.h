@@ -0,0 +1,32 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include "ChecksumKernel.h"
+#include "MatchEngine.h"
+#include "MatchFilter.h"
+#include "MonTable.h"
+#include "NumaTopology.h"
+#include "OtidTable.h"
+using namespace std;
+
+struct RunContext {
+    long long pid;
+    int frames;
+    MatchFilter filter;
+    vector<string> enemyList;
+    OtidTable otidTable;
+    MonTable monTable;
+    MatchEngine engine;
+    EnemyKeyIndex enemyKeyIndex;
+    NumaTopology topology;
+    vector<int> workerCpus;
+    vector<vector<long long>> nodeEnemyKeys;
+
+    RunContext(long long pid, int frames, MatchFilter filter, ChecksumKernel kernel, const string dataOrder[], map<string, vector<int>> &dataOrderOrder, vector<string> enemyList, map<string, vector<long long>> &enemyDict, OtidTable otidTable);
+    void pinWorkers(int threads);
+    void placeOnNumaNodes();
+    const vector<long long> &localEnemyKeys() const;
+    RunContext(const RunContext &) = delete;
+    RunContext &operator=(const RunContext &) = delete;
+};
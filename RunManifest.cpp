@@ -0,0 +1,175 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include "RunManifest.h"
+using namespace std;
+
+const string MANIFEST_VERSION = "1";
+
+const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+/* ******************************************************
+ * Purpose: Folds bytes into a 64 bit FNV-1a hash
+ * ******************************************************
+ * Parameters:
+ *   bytes: bytes to hash
+ *   length: number of bytes
+ *   hash: hash so far
+ * ******************************************************
+*/
+uint64_t fnv1a(const char* bytes, size_t length, uint64_t hash) {
+    for (size_t byteIndex = 0; byteIndex < length; byteIndex++) {
+        hash = (hash ^ (unsigned char)bytes[byteIndex]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/* ******************************************************
+ * Purpose: Formats a hash as 16 hex digits
+ * ******************************************************
+ * Parameters:
+ *   hash: hash to format
+ * ******************************************************
+*/
+string hashToHex(uint64_t hash) {
+    stringstream stream;
+    stream << hex << setfill('0') << setw(16) << hash;
+    return stream.str();
+}
+
+/* ******************************************************
+ * Purpose: Hashes a file's bytes with 64 bit FNV-1a so a
+ *   resumed run can tell its inputs have not changed
+ * ******************************************************
+ * Parameters:
+ *   fileName: file to hash, a missing file hashes as
+ *     "missing"
+ * ******************************************************
+*/
+string hashFile(string fileName) {
+    ifstream file(fileName, ios::binary);
+    if (!file.is_open()) {
+        return "missing";
+    }
+    uint64_t hash = FNV_OFFSET_BASIS;
+    char buffer[65536];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+        hash = fnv1a(buffer, file.gcount(), hash);
+    }
+    return hashToHex(hash);
+}
+
+/* ******************************************************
+ * Purpose: Hashes bytes held in memory with 64 bit FNV-1a
+ * ******************************************************
+ * Parameters:
+ *   bytes: bytes to hash
+ * ******************************************************
+*/
+string hashBytes(string bytes) {
+    return hashBytes(bytes.data(), bytes.size());
+}
+
+/* ******************************************************
+ * Purpose: Hashes bytes in place, such as a mapped file,
+ *   with 64 bit FNV-1a
+ * ******************************************************
+ * Parameters:
+ *   bytes: bytes to hash
+ *   length: number of bytes
+ * ******************************************************
+*/
+string hashBytes(const char* bytes, size_t length) {
+    return hashToHex(fnv1a(bytes, length, FNV_OFFSET_BASIS));
+}
+
+/* ******************************************************
+ * Purpose: Reads a run manifest of name=value lines
+ * ******************************************************
+ * Parameters:
+ *   manifestPath: manifest file
+ *   manifest: Outputs the run parameters and progress
+ * ******************************************************
+*/
+bool readRunManifest(string manifestPath, RunManifest &manifest) {
+    ifstream manifestFile(manifestPath);
+    if (!manifestFile.is_open()) {
+        return false;
+    }
+    string manifestLine = "";
+    bool versionFound = false;
+    while (getline(manifestFile, manifestLine)) {
+        size_t equalsIndex = manifestLine.find("=");
+        if (equalsIndex == string::npos) {
+            continue;
+        }
+        string name = manifestLine.substr(0, equalsIndex);
+        string value = manifestLine.substr(equalsIndex + 1);
+        if (name == "version") {
+            versionFound = value == MANIFEST_VERSION;
+        } else if (name == "committedTiles") {
+            manifest.committedTiles = stoull(value);
+        } else if (name == "committedBytes") {
+            manifest.committedBytes = stoull(value);
+        } else {
+            manifest.parameters[name] = value;
+        }
+    }
+    return versionFound;
+}
+
+/* ******************************************************
+ * Purpose: Writes a run manifest. The manifest is written
+ *   to a temporary file and renamed over the old one so
+ *   a run killed mid-write keeps the previous checkpoint.
+ * ******************************************************
+ * Parameters:
+ *   manifestPath: manifest file
+ *   manifest: run parameters and progress
+ * ******************************************************
+*/
+void writeRunManifest(string manifestPath, const RunManifest &manifest) {
+    string temporaryPath = manifestPath + ".tmp";
+    {
+        ofstream manifestFile(temporaryPath, ios::out | ios::trunc);
+        manifestFile << "version=" << MANIFEST_VERSION << '\n';
+        for (const pair<const string, string> &parameter : manifest.parameters) {
+            manifestFile << parameter.first << '=' << parameter.second << '\n';
+        }
+        manifestFile << "committedTiles=" << manifest.committedTiles << '\n';
+        manifestFile << "committedBytes=" << manifest.committedBytes << '\n';
+    }
+    filesystem::rename(temporaryPath, manifestPath);
+}
+
+/* ******************************************************
+ * Purpose: Finds the first run parameter that differs
+ *   between two manifests
+ * ******************************************************
+ * Parameters:
+ *   expected: manifest of the current invocation
+ *   found: manifest read from disk
+ * ******************************************************
+ * Output: name of the differing parameter, empty if all
+ *   parameters match
+ * ******************************************************
+*/
+string manifestMismatch(const RunManifest &expected, const RunManifest &found) {
+    for (const pair<const string, string> &parameter : expected.parameters) {
+        map<string, string>::const_iterator foundParameter = found.parameters.find(parameter.first);
+        if (foundParameter == found.parameters.end() || foundParameter->second != parameter.second) {
+            return parameter.first;
+        }
+    }
+    for (const pair<const string, string> &parameter : found.parameters) {
+        if (!expected.parameters.count(parameter.first)) {
+            return parameter.first;
+        }
+    }
+    return "";
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+using namespace std;
+
+struct RunManifest {
+    map<string, string> parameters;
+    size_t committedTiles = 0;
+    uint64_t committedBytes = 0;
+};
+
+string hashFile(string fileName);
+string hashBytes(string bytes);
+string hashBytes(const char* bytes, size_t length);
+bool readRunManifest(string manifestPath, RunManifest &manifest);
+void writeRunManifest(string manifestPath, const RunManifest &manifest);
+string manifestMismatch(const RunManifest &expected, const RunManifest &found);
@@ -0,0 +1,180 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "RunMetrics.h"
+using namespace std;
+using namespace chrono;
+
+// Each thread takes the next counter slot the first time it counts
+atomic<size_t> nextWorkerSlot(0);
+thread_local size_t workerSlot = nextWorkerSlot++ % MAX_METRIC_WORKERS;
+
+RunMetrics::RunMetrics() : counters_(new WorkerCounters[MAX_METRIC_WORKERS]) {
+}
+
+RunMetrics::~RunMetrics() {
+    stopProgress();
+}
+
+/* ******************************************************
+ * Purpose: Returns the calling thread's counters. Only
+ *   that thread adds to them, with relaxed atomics.
+ * ******************************************************
+*/
+WorkerCounters &RunMetrics::local() {
+    return counters_[workerSlot];
+}
+
+/* ******************************************************
+ * Purpose: Records the wall time of a phase of the run
+ * ******************************************************
+ * Parameters:
+ *   name: phase name such as parse or compute
+ *   elapsed: wall time of the phase
+ * ******************************************************
+*/
+void RunMetrics::addPhase(string name, steady_clock::duration elapsed) {
+    phases_.push_back(pair<string, double>(name, duration<double>(elapsed).count()));
+}
+
+/* ******************************************************
+ * Purpose: Sums every worker's counters
+ * ******************************************************
+*/
+RunMetrics::Totals RunMetrics::totals() const {
+    Totals sum = Totals();
+    for (size_t slot = 0; slot < MAX_METRIC_WORKERS; slot++) {
+        sum.tiles += counters_[slot].tiles.load(memory_order_relaxed);
+        sum.candidates += counters_[slot].candidates.load(memory_order_relaxed);
+        sum.matches += counters_[slot].matches.load(memory_order_relaxed);
+        sum.aces += counters_[slot].aces.load(memory_order_relaxed);
+        sum.computeNanos += counters_[slot].computeNanos.load(memory_order_relaxed);
+    }
+    return sum;
+}
+
+/* ******************************************************
+ * Purpose: Starts printing a progress line with rate and
+ *   ETA every interval until stopProgress
+ * ******************************************************
+ * Parameters:
+ *   tiles: tiles the sweep will calculate
+ *   candidates: TID, frame and mon combinations in them
+ *   interval: time between progress lines, 0 for none
+ *   bytesWritten: reads the bytes written so far
+ * ******************************************************
+*/
+void RunMetrics::startProgress(uint64_t tiles, uint64_t candidates, milliseconds interval, function<uint64_t()> bytesWritten) {
+    totalTiles_ = tiles;
+    totalCandidates_ = candidates;
+    bytesWrittenSource_ = bytesWritten;
+    progressStart_ = steady_clock::now();
+    progressStop_ = false;
+    if (interval.count() <= 0) {
+        return;
+    }
+    progress_ = thread([this, interval] {
+        unique_lock<mutex> lock(progressMutex_);
+        while (!progressCv_.wait_for(lock, interval, [this] { return progressStop_; })) {
+            cout << progressLine() + "\n" << flush;
+        }
+        });
+}
+
+/* ******************************************************
+ * Purpose: Stops the progress line and keeps the final
+ *   bytes written for the metrics file
+ * ******************************************************
+*/
+void RunMetrics::stopProgress() {
+    {
+        unique_lock<mutex> lock(progressMutex_);
+        progressStop_ = true;
+    }
+    progressCv_.notify_all();
+    if (progress_.joinable()) {
+        progress_.join();
+    }
+    if (bytesWrittenSource_) {
+        bytesWritten_ = bytesWrittenSource_();
+        bytesWrittenSource_ = nullptr;
+    }
+}
+
+/* ******************************************************
+ * Purpose: Formats tiles done, rate, matches and ETA
+ * ******************************************************
+*/
+string RunMetrics::progressLine() const {
+    Totals sum = totals();
+    double elapsed = duration<double>(steady_clock::now() - progressStart_).count();
+    double fraction = totalTiles_ > 0 ? (double)sum.tiles / totalTiles_ : 1.0;
+    double rate = elapsed > 0 ? sum.candidates / elapsed : 0.0;
+    uint64_t bytes = bytesWrittenSource_ ? bytesWrittenSource_() : bytesWritten_;
+
+    stringstream line;
+    line << fixed << setprecision(1) << "Progress: " << sum.tiles << "/" << totalTiles_ << " tiles (" << fraction * 100 << "%), "
+        << rate / 1e6 << "M candidates/s, " << sum.matches << " matches, " << sum.aces << " aces, "
+        << bytes / 1048576.0 << " MB written, ETA ";
+    if (sum.tiles > 0) {
+        line << elapsed * (totalTiles_ - sum.tiles) / sum.tiles << "s";
+    } else {
+        line << "unknown";
+    }
+    return line.str();
+}
+
+/* ******************************************************
+ * Purpose: Writes the run's metrics as JSON
+ * ******************************************************
+ * Parameters:
+ *   metricsPath: file to write
+ *   runInfo: extra fields as raw JSON values by name
+ * ******************************************************
+*/
+void RunMetrics::writeJson(string metricsPath, const map<string, string> &runInfo) const {
+    Totals sum = totals();
+    double computeSeconds = 0;
+    for (const pair<string, double> &phase : phases_) {
+        if (phase.first == "compute") {
+            computeSeconds = phase.second;
+        }
+    }
+
+    ofstream metricsFile(metricsPath, ios::out | ios::trunc);
+    metricsFile << fixed << setprecision(6) << "{\n";
+    for (const pair<const string, string> &info : runInfo) {
+        metricsFile << "  \"" << info.first << "\": " << info.second << ",\n";
+    }
+    metricsFile << "  \"phases\": {";
+    for (size_t phaseIndex = 0; phaseIndex < phases_.size(); phaseIndex++) {
+        metricsFile << (phaseIndex > 0 ? ", " : "") << "\"" << phases_[phaseIndex].first << "\": " << phases_[phaseIndex].second;
+    }
+    metricsFile << "},\n";
+    metricsFile << "  \"tiles\": " << sum.tiles << ",\n";
+    metricsFile << "  \"candidates\": " << sum.candidates << ",\n";
+    metricsFile << "  \"matches\": " << sum.matches << ",\n";
+    metricsFile << "  \"aces\": " << sum.aces << ",\n";
+    metricsFile << "  \"bytesWritten\": " << bytesWritten_ << ",\n";
+    metricsFile << "  \"candidatesPerSecond\": " << (computeSeconds > 0 ? sum.candidates / computeSeconds : 0.0) << ",\n";
+    metricsFile << "  \"workers\": [";
+    bool firstWorker = true;
+    for (size_t slot = 0; slot < MAX_METRIC_WORKERS; slot++) {
+        const WorkerCounters &counters = counters_[slot];
+        if (counters.tiles.load(memory_order_relaxed) == 0) {
+            continue;
+        }
+        metricsFile << (firstWorker ? "\n" : ",\n") << "    {\"tiles\": " << counters.tiles.load(memory_order_relaxed)
+            << ", \"candidates\": " << counters.candidates.load(memory_order_relaxed)
+            << ", \"matches\": " << counters.matches.load(memory_order_relaxed)
+            << ", \"aces\": " << counters.aces.load(memory_order_relaxed)
+            << ", \"computeSeconds\": " << counters.computeNanos.load(memory_order_relaxed) / 1e9 << "}";
+        firstWorker = false;
+    }
+    metricsFile << (firstWorker ? "]\n" : "\n  ]\n") << "}\n";
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Counters of one worker thread, on their own cache line so
+// workers never contend
+struct alignas(64) WorkerCounters {
+    atomic<uint64_t> tiles{ 0 };
+    atomic<uint64_t> candidates{ 0 };
+    atomic<uint64_t> matches{ 0 };
+    atomic<uint64_t> aces{ 0 };
+    atomic<uint64_t> computeNanos{ 0 };
+};
+
+const size_t MAX_METRIC_WORKERS = 256;
+
+class RunMetrics {
+public:
+RunMetrics();
+~RunMetrics();
+WorkerCounters &local();
+void addPhase(string name, chrono::steady_clock::duration elapsed);
+void startProgress(uint64_t tiles, uint64_t candidates, chrono::milliseconds interval, function<uint64_t()> bytesWritten);
+void stopProgress();
+string progressLine() const;
+void writeJson(string metricsPath, const map<string, string> &runInfo) const;
+
+private:
+struct Totals {
+    uint64_t tiles = 0;
+    uint64_t candidates = 0;
+    uint64_t matches = 0;
+    uint64_t aces = 0;
+    uint64_t computeNanos = 0;
+};
+Totals totals() const;
+
+unique_ptr<WorkerCounters[]> counters_;
+vector<pair<string, double>> phases_;
+uint64_t totalTiles_ = 0;
+uint64_t totalCandidates_ = 0;
+uint64_t bytesWritten_ = 0;
+function<uint64_t()> bytesWrittenSource_;
+chrono::steady_clock::time_point progressStart_;
+mutex progressMutex_;
+condition_variable progressCv_;
+bool progressStop_ = false;
+thread progress_;
+};
@@ -0,0 +1,83 @@
+#include <vector>
+#include "SweepTile.h"
+using namespace std;
+
+/* ******************************************************
+ * Purpose: Splits the TID x frame space into tiles of
+ *   one TID and up to tileFrames frames, in TID then
+ *   frame order
+ * ******************************************************
+ * Parameters:
+ *   tidStart: first TID (inclusive)
+ *   tidEnd: last TID (inclusive)
+ *   firstFrame: first frame to calc
+ *   frames: frame to stop before
+ *   tileFrames: max frames per tile
+ * ******************************************************
+*/
+vector<SweepTile> buildSweepTiles(int tidStart, int tidEnd, int firstFrame, int frames, int tileFrames) {
+    vector<SweepTile> tiles = vector<SweepTile>();
+    for (int tid = tidStart; tid <= tidEnd; tid++) {
+        for (int frameStart = firstFrame; frameStart < frames; frameStart += tileFrames) {
+            int frameEnd = frameStart + tileFrames < frames ? frameStart + tileFrames : frames;
+            tiles.push_back({ tid, frameStart, frameEnd });
+        }
+    }
+    return tiles;
+}
+
+/* ******************************************************
+ * Purpose: Splits the TID x frame space into the same
+ *   tiles as buildSweepTiles, but in frame then TID
+ *   order, so every TID's early frames are calculated
+ *   before any TID's later ones
+ * ******************************************************
+ * Parameters:
+ *   tidStart: first TID (inclusive)
+ *   tidEnd: last TID (inclusive)
+ *   firstFrame: first frame to calc
+ *   frames: frame to stop before
+ *   tileFrames: max frames per tile
+ * ******************************************************
+*/
+vector<SweepTile> buildFrameMajorTiles(int tidStart, int tidEnd, int firstFrame, int frames, int tileFrames) {
+    vector<SweepTile> tiles = vector<SweepTile>();
+    for (int frameStart = firstFrame; frameStart < frames; frameStart += tileFrames) {
+        int frameEnd = frameStart + tileFrames < frames ? frameStart + tileFrames : frames;
+        for (int tid = tidStart; tid <= tidEnd; tid++) {
+            tiles.push_back({ tid, frameStart, frameEnd });
+        }
+    }
+    return tiles;
+}
+
+/* ******************************************************
+ * Purpose: Picks one shard of a run's tiles. Shards are
+ *   contiguous runs of tiles with about the same number
+ *   of frames each, so every shard writes a sorted slice
+ *   of the run and the same arguments always give the
+ *   same shards.
+ * ******************************************************
+ * Parameters:
+ *   tiles: tiles of the whole run in write order
+ *   shardIndex: shard to pick, 0 based
+ *   shardCount: number of shards
+ * ******************************************************
+*/
+vector<SweepTile> shardSweepTiles(const vector<SweepTile> &tiles, int shardIndex, int shardCount) {
+    long long totalFrames = 0;
+    for (const SweepTile &tile : tiles) {
+        totalFrames += tile.frameEnd - tile.frameStart;
+    }
+
+    // A tile belongs to the shard its first frame falls in
+    vector<SweepTile> shardTiles = vector<SweepTile>();
+    long long framesBefore = 0;
+    for (const SweepTile &tile : tiles) {
+        if (framesBefore * shardCount / totalFrames == shardIndex) {
+            shardTiles.push_back(tile);
+        }
+        framesBefore += tile.frameEnd - tile.frameStart;
+    }
+    return shardTiles;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <vector>
+using namespace std;
+
+struct SweepTile {
+    int tid;
+    int frameStart;
+    int frameEnd;
+};
+
+const int DEFAULT_TILE_FRAMES = 8192;
+
+vector<SweepTile> buildSweepTiles(int tidStart, int tidEnd, int firstFrame, int frames, int tileFrames);
+vector<SweepTile> buildFrameMajorTiles(int tidStart, int tidEnd, int firstFrame, int frames, int tileFrames);
+vector<SweepTile> shardSweepTiles(const vector<SweepTile> &tiles, int shardIndex, int shardCount);
@@ -1,74 +1,34 @@
+#include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <vector>
+#include "NumaTopology.h"
 #include "ThreadPool.h"
 using namespace std;
 
-
-// Vector to store worker threads
-vector<thread> threads_;
-
-// Queue of tasks
-queue<function<void()> > tasks_;
-
-// Mutex to synchronize access to shared data
-mutex queue_mutex_;
-
-// Condition variable to signal changes in the state of
-// the tasks queue
-condition_variable cv_;
-
-// Flag to indicate whether the thread pool should stop
-// or not
-bool stop_ = false;
-
-// Flag to indicate whether the thread pool is finished
-bool finished = false;
-
-// // Constructor to creates a thread pool with given
-// number of threads
-ThreadPool::ThreadPool(size_t num_threads
-    = thread::hardware_concurrency())
+// Constructor to creates a thread pool with given
+// number of threads. Each worker owns a task queue
+// and steals from the others when its own is empty.
+// Worker i is pinned to workerCpus[i] when given.
+ThreadPool::ThreadPool(size_t num_threads, vector<int> workerCpus)
 {
+    for (size_t i = 0; i < num_threads; ++i) {
+        queues_.emplace_back(new WorkerQueue());
+    }
 
     // Creating worker threads
     for (size_t i = 0; i < num_threads; ++i) {
-        threads_.emplace_back([this] {
-            while (true) {
-                function<void()> task;
-                // The reason for putting the below code
-                // here is to unlock the queue before
-                // executing the task so that other
-                // threads can perform enqueue tasks
-                {
-                    // Locking the queue so that data
-                    // can be shared safely
-                    unique_lock<mutex> lock(
-                        queue_mutex_);
-
-                    // Waiting until there is a task to
-                    // execute or the pool is stopped
-                    cv_.wait(lock, [this] {
-                        return !tasks_.empty() || stop_;
-                        });
-
-                    // exit the thread in case the pool
-                    // is stopped and there are no tasks
-                    if (stop_ && tasks_.empty()) {
-                        finished = true;
-                        return;
-                    }
-
-                    // Get the next task from the queue
-                    task = move(tasks_.front());
-                    tasks_.pop();
-                }
-
-                task();
+        threads_.emplace_back([this, i, workerCpus] {
+            if (!workerCpus.empty()) {
+                pinThreadToCpu(workerCpus[i % workerCpus.size()]);
             }
+            workerLoop(i);
             });
     }
 }
@@ -76,39 +36,105 @@ ThreadPool::ThreadPool(size_t num_threads
 // Destructor to stop the thread pool
 ThreadPool::~ThreadPool()
 {
-    {
-        // Lock the queue to update the stop flag safely
-        unique_lock<mutex> lock(queue_mutex_);
-        stop_ = true;
-    }
+    stopAndWait();
+}
 
-    // Notify all threads
-    cv_.notify_all();
+// Runs tasks until the pool is stopped and every
+// queue is empty. Tasks are taken without the pool
+// lock, a worker only sleeps after a scan of every
+// queue finds nothing.
+void ThreadPool::workerLoop(size_t worker)
+{
+    while (true) {
+        function<void()> task;
+        if (takeTask(worker, task)) {
+            --queued_;
+            task();
+            if (--pending_ == 0) {
+                // Under the lock, so a thread checking
+                // pending_ in wait() can't miss this
+                unique_lock<mutex> lock(state_mutex_);
+                done_cv_.notify_all();
+            }
+            continue;
+        }
+
+        // Counted as sleeping before queued_ is checked
+        // again, so enqueue either sees this worker or
+        // this worker sees its task
+        unique_lock<mutex> lock(state_mutex_);
+        ++sleeping_;
+        work_cv_.wait(lock, [this] {
+            return queued_ > 0 || stop_;
+            });
+        --sleeping_;
+        if (stop_ && queued_ == 0) {
+            return;
+        }
+    }
+}
 
-    // Joining all worker threads to ensure they have
-    // completed their tasks
-    for (auto& thread : threads_) {
-        thread.join();
+// Takes the oldest task from this worker's queue, or
+// steals the oldest task of another worker
+bool ThreadPool::takeTask(size_t worker, function<void()> &task)
+{
+    for (size_t offset = 0; offset < queues_.size(); ++offset) {
+        WorkerQueue &queue = *queues_[(worker + offset) % queues_.size()];
+        unique_lock<mutex> lock(queue.mutex_);
+        if (!queue.tasks_.empty()) {
+            task = move(queue.tasks_.front());
+            queue.tasks_.pop_front();
+            return true;
+        }
     }
+    return false;
 }
 
-// Enqueue task for execution by the thread pool
+// Enqueue task for execution by the thread pool.
+// Tasks are dealt round robin to the worker queues,
+// and the pool lock is only taken to wake a worker
+// when one is sleeping.
 void ThreadPool::enqueue(function<void()> task)
 {
-    finished = false;
+    size_t worker = next_queue_++ % queues_.size();
+    ++pending_;
+    ++queued_;
     {
-        unique_lock<std::mutex> lock(queue_mutex_);
-        tasks_.emplace(move(task));
+        unique_lock<mutex> lock(queues_[worker]->mutex_);
+        queues_[worker]->tasks_.emplace_back(move(task));
+    }
+    if (sleeping_ > 0) {
+        unique_lock<mutex> lock(state_mutex_);
+        work_cv_.notify_one();
     }
-    cv_.notify_one();
 }
 
-// Wait for all tasks to complete
+// Block until every enqueued task has finished
+void ThreadPool::wait()
+{
+    unique_lock<mutex> lock(state_mutex_);
+    done_cv_.wait(lock, [this] {
+        return pending_ == 0;
+        });
+}
+
+// Wait for all tasks to complete, then join the workers
 void ThreadPool::stopAndWait()
 {
-    stop_ = true;
-    cv_.notify_all();
-    while (!finished) {
-        this_thread::sleep_for(chrono::milliseconds(1000));
+    wait();
+    {
+        unique_lock<mutex> lock(state_mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
     }
-}
\ No newline at end of file
+}
+
+size_t ThreadPool::size() const
+{
+    return threads_.size();
+}
@@ -1,16 +1,43 @@
 #pragma once
+#include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <vector>
 using namespace std;
 
 class ThreadPool {
 public:
-ThreadPool(size_t num_threads);
+ThreadPool(size_t num_threads, vector<int> workerCpus = vector<int>());
 ~ThreadPool();
 void enqueue(function<void()> task);
+void wait();
 void stopAndWait();
-};
\ No newline at end of file
+size_t size() const;
+
+private:
+struct WorkerQueue {
+    mutex mutex_;
+    deque<function<void()>> tasks_;
+};
+
+bool takeTask(size_t worker, function<void()> &task);
+void workerLoop(size_t worker);
+
+vector<thread> threads_;
+vector<unique_ptr<WorkerQueue>> queues_;
+// Only taken to sleep on or wake a condition variable
+mutex state_mutex_;
+condition_variable work_cv_;
+condition_variable done_cv_;
+atomic<size_t> queued_{ 0 };
+atomic<size_t> pending_{ 0 };
+atomic<size_t> next_queue_{ 0 };
+atomic<size_t> sleeping_{ 0 };
+atomic<bool> stop_{ false };
+};